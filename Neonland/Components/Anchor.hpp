@@ -7,18 +7,6 @@ class Anchor {
 public:
     static constexpr ComponentType componentType = ComponentType::anchor;
     
-    bool operator<(const Anchor& rhs) const {
-        return false;
-    }
-    
-    bool operator>(const Anchor& rhs) const {
-        return false;
-    }
-    
-    bool operator==(const Anchor& rhs) const {
-        return true;
-    }
-    
     float2 screenPosition;
     float3 margin;
     
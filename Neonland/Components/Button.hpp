@@ -7,17 +7,6 @@
 class Button {
 public:
     static constexpr ComponentType componentType = ComponentType::button;
-    bool operator<(const Button& rhs) const {
-        return false;
-    }
-    
-    bool operator>(const Button& rhs) const {
-        return false;
-    }
-    
-    bool operator==(const Button& rhs) const {
-        return true;
-    }
     
     bool highlighted;
     
@@ -12,12 +12,13 @@ Camera::Camera(float3 pos, float3 rot, float3 color, float near, float far, floa
 , _aspectRatio{aspectRatio}
 , _projChanged{true}
 , _positionChanged{true}
-, _rotationChanged{true} {}
+, _rotationChanged{true}
+, _version{0} {}
 
 float3 Camera::ScreenPointToWorld(float2 screenPoint, float depth) {
     float4x4 proj = GetProjectionMatrix();
     float4x4 view = GetViewMatrix();
-
+    
     float4 worldSpaceDepth = {0, 0, depth, 1};
     
     float4 screenSpaceDepth = proj * (view * worldSpaceDepth);
@@ -37,8 +38,11 @@ float3 Camera::Forward(){
 }
 
 void Camera::SetPosition(float3 pos) {
-    _positionChanged = true;
-    _position = pos;
+    if (pos.x != _position.x || pos.y != _position.y || pos.z != _position.z) {
+        _positionChanged = true;
+        _position = pos;
+        _version++;
+    }
 }
 
 const float3& Camera::GetPosition() const {
@@ -46,8 +50,11 @@ const float3& Camera::GetPosition() const {
 }
 
 void Camera::SetRotation(float3 rot) {
-    _rotationChanged = true;
-    _rotation = rot;
+    if (rot.x != _rotation.x || rot.y != _rotation.y || rot.z != _rotation.z) {
+        _rotationChanged = true;
+        _rotation = rot;
+        _version++;
+    }
 }
 
 const float3& Camera::GetRotation() const {
@@ -55,8 +62,11 @@ const float3& Camera::GetRotation() const {
 }
 
 void Camera::SetFarClipPlane(float far) {
-    _projChanged = true;
-    _farClipPlane = far;
+    if (far != _farClipPlane) {
+        _projChanged = true;
+        _farClipPlane = far;
+        _version++;
+    }
 }
 
 float Camera::GetFarClipPlane() const {
@@ -64,8 +74,11 @@ float Camera::GetFarClipPlane() const {
 }
 
 void Camera::SetNearClipPlane(float near) {
-    _projChanged = true;
-    _nearClipPlane = near;
+    if (near != _nearClipPlane) {
+        _projChanged = true;
+        _nearClipPlane = near;
+        _version++;
+    }
 }
 
 float Camera::GetNearClipPlane() const {
@@ -73,8 +86,11 @@ float Camera::GetNearClipPlane() const {
 }
 
 void Camera::SetVerticalFoV(float fov) {
-    _projChanged = true;
-    _verticalFoV = fov;
+    if (fov != _verticalFoV) {
+        _projChanged = true;
+        _verticalFoV = fov;
+        _version++;
+    }
 }
 
 float Camera::GetVerticalFoV() const {
@@ -85,6 +101,7 @@ void Camera::SetAspectRatio(float ratio) {
     if (ratio != _aspectRatio) {
         _projChanged = true;
         _aspectRatio = ratio;
+        _version++;
     }
 }
 
@@ -92,6 +109,10 @@ float Camera::GetAspectRatio() const {
     return _aspectRatio;
 }
 
+uint32_t Camera::GetVersion() const {
+    return _version;
+}
+
 float4x4 Camera::GetProjectionMatrix() {
     if (_projChanged) {
         _projMat = ProjectionMatrix(_verticalFoV, _aspectRatio, _nearClipPlane, _farClipPlane);
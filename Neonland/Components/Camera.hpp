@@ -6,17 +6,6 @@
 class Camera {
 public:
     static constexpr ComponentType componentType = ComponentType::camera;
-    bool operator<(const Camera& rhs) const {
-        return false;
-    }
-    
-    bool operator>(const Camera& rhs) const {
-        return false;
-    }
-    
-    bool operator==(const Camera& rhs) const {
-        return true;
-    }
     
     float3 clearColor;
     
@@ -50,6 +39,9 @@ public:
     void SetAspectRatio(float ratio);
     float GetAspectRatio() const;
     
+    // Changes whenever the view or projection changes
+    uint32_t GetVersion() const;
+    
     float4x4 GetProjectionMatrix();
     float4x4 GetTranslationMatrix();
     float4x4 GetRotationMatrix();
@@ -66,6 +58,8 @@ private:
     bool _positionChanged;
     bool _rotationChanged;
     
+    uint32_t _version;
+    
     float4x4 _projMat;
     float4x4 _translationMatrix;
     float4x4 _rotationMatrix;
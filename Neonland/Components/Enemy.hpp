@@ -6,17 +6,6 @@
 class Enemy {
 public:
     static constexpr ComponentType componentType = ComponentType::enemy;
-    bool operator<(const Enemy& rhs) const {
-        return false;
-    }
-    
-    bool operator>(const Enemy& rhs) const {
-        return false;
-    }
-    
-    bool operator==(const Enemy& rhs) const {
-        return true;
-    }
     
     int attackDamage;
     double attackCooldown;
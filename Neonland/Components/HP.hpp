@@ -5,18 +5,6 @@
 class HP {
 public:
     static constexpr ComponentType componentType = ComponentType::hp;
-    bool operator<(const HP& rhs) const {
-        return false;
-    }
-    
-    bool operator>(const HP& rhs) const {
-        return false;
-    }
-    
-    bool operator==(const HP& rhs) const {
-        return true;
-    }
-    
     
     HP(int max = 1);
     
@@ -20,7 +20,6 @@ public:
         return type == rhs.type && material == rhs.material;
     }
     
-    float4x4 modelMatrix;
     MeshType type;
     Material material;
     
@@ -1,6 +1,7 @@
 #include "Physics.hpp"
 #include <iostream>
 #include <algorithm>
+#include <cmath>
 
 Physics::Physics(const Transform& tf, float3 vel, float3 angularVel, float radius)
 : velocity{vel}
@@ -11,8 +12,8 @@ Physics::Physics(const Transform& tf, float3 vel, float3 angularVel, float radiu
 , prevPosition{tf.position}
 , prevRotation{tf.rotation} {}
 
-bool Physics::Overlapping(const Physics& a, const Physics& b,
-                        const Transform& tfA, const Transform& tfB, float epsilon) {
+bool Physics::Overlapping(PhysicsRef a, PhysicsRef b,
+                        TransformRef tfA, TransformRef tfB, float epsilon) {
     float3 aToB = a.position - b.position;
     aToB.z = 0;
     
@@ -23,7 +24,42 @@ bool Physics::Overlapping(const Physics& a, const Physics& b,
     return dist - epsilon < radA + radB;
 }
 
-void Physics::Update(Physics& physics, Transform& tf, double timestep) {
+std::optional<float> Physics::SweptHitTime(PhysicsRef a, PhysicsRef b,
+                                           TransformRef tfA, TransformRef tfB) {
+    const float3 start = a.prevPosition;
+    const float3 end = a.position;
+    const float3 center = b.position;
+    
+    const float2 sweep = {end.x - start.x, end.y - start.y};
+    const float2 fromCenter = {start.x - center.x, start.y - center.y};
+    const float reach = a.GetScaledCollisionRadius(tfA) + b.GetScaledCollisionRadius(tfB);
+    
+    // Solves |fromCenter + sweep * t| = reach for the first t in [0, 1]
+    const float c = fromCenter.x * fromCenter.x + fromCenter.y * fromCenter.y - reach * reach;
+    
+    if (c < 0) {
+        return 0.0f;
+    }
+    
+    const float sweepSquared = sweep.x * sweep.x + sweep.y * sweep.y;
+    const float halfB = fromCenter.x * sweep.x + fromCenter.y * sweep.y;
+    const float discriminant = halfB * halfB - sweepSquared * c;
+    
+    // Not moving, moving away, or passing by without touching
+    if (sweepSquared == 0 || halfB >= 0 || discriminant <= 0) {
+        return std::nullopt;
+    }
+    
+    const float t = (-halfB - std::sqrt(discriminant)) / sweepSquared;
+    
+    if (t > 1) {
+        return std::nullopt;
+    }
+    
+    return t;
+}
+
+void Physics::Update(PhysicsRef physics, TransformRef tf, double timestep) {
     physics.prevPosition = physics.position;
     physics.prevRotation = physics.rotation;
     
@@ -54,3 +90,44 @@ float3 Physics::GetInterpolatedPosition(double interpolation) const {
 float3 Physics::GetInterpolatedRotation(double interpolation) const {
     return prevRotation + (rotation - prevRotation) * interpolation;
 }
+
+PhysicsRef::PhysicsRef(Physics& physics)
+: velocity{physics.velocity}
+, angularVelocity{physics.angularVelocity}
+, collisionRadius{physics.collisionRadius}
+, position{physics.position}
+, rotation{physics.rotation}
+, prevPosition{physics.prevPosition}
+, prevRotation{physics.prevRotation} {}
+
+PhysicsRef::PhysicsRef(PhysicsColumns& columns, size_t index)
+: velocity{columns.At<&Physics::velocity>(index)}
+, angularVelocity{columns.At<&Physics::angularVelocity>(index)}
+, collisionRadius{columns.At<&Physics::collisionRadius>(index)}
+, position{columns.At<&Physics::position>(index)}
+, rotation{columns.At<&Physics::rotation>(index)}
+, prevPosition{columns.At<&Physics::prevPosition>(index)}
+, prevRotation{columns.At<&Physics::prevRotation>(index)} {}
+
+auto PhysicsRef::operator=(const Physics& physics) -> PhysicsRef& {
+    velocity = physics.velocity;
+    angularVelocity = physics.angularVelocity;
+    collisionRadius = physics.collisionRadius;
+    position = physics.position;
+    rotation = physics.rotation;
+    prevPosition = physics.prevPosition;
+    prevRotation = physics.prevRotation;
+    return *this;
+}
+
+float3 PhysicsRef::GetInterpolatedPosition(double interpolation) const {
+    return prevPosition + (position - prevPosition) * interpolation;
+}
+
+float3 PhysicsRef::GetInterpolatedRotation(double interpolation) const {
+    return prevRotation + (rotation - prevRotation) * interpolation;
+}
+
+float PhysicsRef::GetScaledCollisionRadius(TransformRef tf) const {
+    return collisionRadius * std::min({tf.scale.x, tf.scale.y, tf.scale.z});
+}
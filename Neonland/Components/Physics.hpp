@@ -1,27 +1,25 @@
 #pragma once
+#include <optional>
 #include "../Engine/MathUtils.hpp"
 #include "../Engine/ComponentType.hpp"
+#include "../Engine/SoA.hpp"
 #include "Transform.hpp"
 
+class PhysicsRef;
+
 class Physics {
 public:
     static constexpr ComponentType componentType = ComponentType::physics;
-    bool operator<(const Physics& rhs) const {
-        return false;
-    }
-    
-    bool operator>(const Physics& rhs) const {
-        return false;
-    }
     
-    bool operator==(const Physics& rhs) const {
-        return true;
-    }
+    static bool Overlapping(PhysicsRef a, PhysicsRef b,
+                            TransformRef tfA, TransformRef tfB, float epsilon = 0.0f);
     
-    static bool Overlapping(const Physics& a, const Physics& b,
-                            const Transform& tfA, const Transform& tfB, float epsilon = 0.0f);
+    // Sweeps a from its prevPosition to its position against b at its position, in the xy plane.
+    // Returns the fraction of the sweep at which they first overlap, 0 if they already overlap at the start.
+    static std::optional<float> SweptHitTime(PhysicsRef a, PhysicsRef b,
+                                             TransformRef tfA, TransformRef tfB);
     
-    static void Update(Physics& physics, Transform& tf, double timestep);
+    static void Update(PhysicsRef physics, TransformRef tf, double timestep);
     
     float3 velocity;
     float3 angularVelocity;
@@ -40,3 +38,36 @@ public:
     float3 prevPosition;
     float3 prevRotation;
 };
+
+using PhysicsColumns = SoAColumns<&Physics::velocity, &Physics::angularVelocity, &Physics::collisionRadius,
+                                  &Physics::position, &Physics::rotation, &Physics::prevPosition, &Physics::prevRotation>;
+
+// Physics stored in a PhysicsColumns row, or an ordinary Physics
+class PhysicsRef {
+public:
+    Float3Ref velocity;
+    Float3Ref angularVelocity;
+    
+    float& collisionRadius;
+    
+    Float3Ref position;
+    Float3Ref rotation;
+    Float3Ref prevPosition;
+    Float3Ref prevRotation;
+    
+    PhysicsRef(Physics& physics);
+    PhysicsRef(PhysicsColumns& columns, size_t index);
+    
+    auto operator=(const Physics& physics) -> PhysicsRef&;
+    
+    float3 GetInterpolatedPosition(double interpolation) const;
+    float3 GetInterpolatedRotation(double interpolation) const;
+    
+    float GetScaledCollisionRadius(TransformRef tf) const;
+};
+
+template<>
+struct SoALayout<Physics> {
+    using Columns = PhysicsColumns;
+    using Ref = PhysicsRef;
+};
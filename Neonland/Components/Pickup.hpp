@@ -11,18 +11,6 @@ public:
     
     static constexpr ComponentType componentType = ComponentType::pickup;
     
-    bool operator<(const Pickup& rhs) const {
-        return false;
-    }
-    
-    bool operator>(const Pickup& rhs) const {
-        return false;
-    }
-    
-    bool operator==(const Pickup& rhs) const {
-        return true;
-    }
-    
     Type type;
     
     Pickup(Type type);
@@ -6,17 +6,6 @@
 class PlayerProjectile {
 public:
     static constexpr ComponentType componentType = ComponentType::playerProjectile;
-    bool operator<(const PlayerProjectile& rhs) const {
-        return false;
-    }
-    
-    bool operator>(const PlayerProjectile& rhs) const {
-        return false;
-    }
-    
-    bool operator==(const PlayerProjectile& rhs) const {
-        return true;
-    }
     
     int damage;
     float lifespan;
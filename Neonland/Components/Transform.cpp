@@ -18,3 +18,43 @@ void Transform::SetRotation(float3 rot) {
     rotationSet = true;
     rotation = rot;
 }
+
+TransformRef::TransformRef(Transform& tf)
+: position{tf.position}
+, scale{tf.scale}
+, rotation{tf.rotation}
+, teleported{tf.teleported}
+, rotationSet{tf.rotationSet} {}
+
+TransformRef::TransformRef(TransformColumns& columns, size_t index)
+: position{columns.At<&Transform::position>(index)}
+, scale{columns.At<&Transform::scale>(index)}
+, rotation{columns.At<&Transform::rotation>(index)}
+, teleported{columns.At<&Transform::teleported>(index)}
+, rotationSet{columns.At<&Transform::rotationSet>(index)} {}
+
+auto TransformRef::operator=(const Transform& tf) -> TransformRef& {
+    position = tf.position;
+    scale = tf.scale;
+    rotation = tf.rotation;
+    teleported = tf.teleported;
+    rotationSet = tf.rotationSet;
+    return *this;
+}
+
+TransformRef::operator Transform() const {
+    auto tf = Transform(position, rotation, scale);
+    tf.teleported = teleported;
+    tf.rotationSet = rotationSet;
+    return tf;
+}
+
+void TransformRef::Teleport(float3 pos) {
+    teleported = true;
+    position = pos;
+}
+
+void TransformRef::SetRotation(float3 rot) {
+    rotationSet = true;
+    rotation = rot;
+}
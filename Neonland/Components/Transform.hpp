@@ -1,21 +1,11 @@
 #pragma once
 #include "../Engine/MathUtils.hpp"
 #include "../Engine/ComponentType.hpp"
+#include "../Engine/SoA.hpp"
 
 class Transform {
 public:
     static constexpr ComponentType componentType = ComponentType::transform;
-    bool operator<(const Transform& rhs) const {
-        return false;
-    }
-    
-    bool operator>(const Transform& rhs) const {
-        return false;
-    }
-    
-    bool operator==(const Transform& rhs) const {
-        return true;
-    }
     
     float3 position;
     float3 scale;
@@ -29,3 +19,32 @@ public:
     void Teleport(float3 pos);
     void SetRotation(float3 rot);
 };
+
+using TransformColumns = SoAColumns<&Transform::position, &Transform::scale, &Transform::rotation,
+                                    &Transform::teleported, &Transform::rotationSet>;
+
+// Transform stored in a TransformColumns row, or an ordinary Transform
+class TransformRef {
+public:
+    Float3Ref position;
+    Float3Ref scale;
+    Float3Ref rotation;
+    
+    bool& teleported;
+    bool& rotationSet;
+    
+    TransformRef(Transform& tf);
+    TransformRef(TransformColumns& columns, size_t index);
+    
+    auto operator=(const Transform& tf) -> TransformRef&;
+    operator Transform() const;
+    
+    void Teleport(float3 pos);
+    void SetRotation(float3 rot);
+};
+
+template<>
+struct SoALayout<Transform> {
+    using Columns = TransformColumns;
+    using Ref = TransformRef;
+};
@@ -6,6 +6,19 @@ EnemyType::EnemyType(Enemy enemy, Mesh mesh, float3 scale, int maxHP)
 , scale(scale)
 , maxHP{maxHP} {}
 
+auto EnemyType::MakePrefab() const -> EnemyPrefab {
+    auto tf = Transform(float3{0, 0, -scale.z / 2}, float3{0, 0, 0}, scale);
+    
+    auto tintedMesh = mesh;
+    tintedMesh.tint = {0, 0, 0, 1};
+    
+    return EnemyPrefab(Physics(tf, float3{0, 0, 0}, float3{0, -90 * enemy.maxMovementSpeed, 0}, 0.6f),
+                       tf,
+                       tintedMesh,
+                       enemy,
+                       HP(maxHP));
+}
+
 const EnemyType& EnemyType::Swarm() {
     static const auto swarm = EnemyType(Enemy(3, 0.4f, 5, 4),
                                         Mesh(CUBE_MESH, Material(LIT_SHADER, NO_TEX, float4{0.24, 0.86, 0.59, 1})),
@@ -2,6 +2,12 @@
 
 #include "./Components/Enemy.hpp"
 #include "./Components/Mesh.hpp"
+#include "./Components/Physics.hpp"
+#include "./Components/Transform.hpp"
+#include "./Components/HP.hpp"
+#include "./Engine/Prefab.hpp"
+
+using EnemyPrefab = Prefab<Physics, Transform, Mesh, Enemy, HP>;
 
 class EnemyType {
 public:
@@ -16,6 +22,9 @@ public:
     const float3 scale;
     const int maxHP;
     
+    // Spawn position and rotation are set per instance
+    auto MakePrefab() const -> EnemyPrefab;
+    
 private:
     EnemyType(Enemy enemy, Mesh mesh, float3 scale, int maxHP);
 };
@@ -0,0 +1,160 @@
+#include "Archetype.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <cassert>
+
+namespace {
+
+size_t AlignUp(size_t offset, size_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+}
+
+Archetype::Archetype(ComponentMask mask, const std::array<ComponentInfo, COMPONENT_COUNT>& infos, std::vector<size_t>& entityIdToRow)
+: mask{mask}
+, infos{infos}
+, capacity{0}
+, size{0}
+, entityIdToRow{entityIdToRow}
+, lockCount{0} {
+    columnOffsets.fill(NO_COLUMN);
+    
+    size_t rowSize = sizeof(Entity);
+    for (size_t i = 0; i < COMPONENT_COUNT; i++) {
+        if (mask[i]) {
+            rowSize += infos[i].size;
+        }
+    }
+    
+    // Shrink the capacity until the columns and their alignment padding fit in a chunk
+    for (capacity = CHUNK_SIZE / rowSize; capacity > 0; capacity--) {
+        size_t offset = sizeof(Entity) * capacity;
+        
+        for (size_t i = 0; i < COMPONENT_COUNT; i++) {
+            if (mask[i]) {
+                offset = AlignUp(offset, infos[i].alignment);
+                columnOffsets[i] = offset;
+                offset += infos[i].size * capacity;
+            }
+        }
+        
+        if (offset <= CHUNK_SIZE) {
+            break;
+        }
+    }
+    
+    assert(capacity > 0 && "Components of an archetype must fit in a single chunk");
+}
+
+Archetype::~Archetype() {
+    for (size_t row = 0; row < size; row++) {
+        for (size_t i = 0; i < COMPONENT_COUNT; i++) {
+            if (mask[i]) {
+                infos[i].destroy(GetComponent(row, static_cast<ComponentType>(i)));
+            }
+        }
+    }
+}
+
+auto Archetype::Size() const -> size_t {
+    return size;
+}
+
+auto Archetype::ChunkCount() const -> size_t {
+    return (size + capacity - 1) / capacity;
+}
+
+auto Archetype::ChunkCapacity() const -> size_t {
+    return capacity;
+}
+
+auto Archetype::RowCount(size_t chunkIdx) const -> size_t {
+    return std::min(capacity, size - chunkIdx * capacity);
+}
+
+auto Archetype::GetEntities(size_t chunkIdx) -> Entity* {
+    return reinterpret_cast<Entity*>(chunks[chunkIdx]->data);
+}
+
+auto Archetype::GetComponent(size_t row, ComponentType type) -> void* {
+    auto typeIdx = to_underlying(type);
+    assert(columnOffsets[typeIdx] != NO_COLUMN && "Archetype must contain the component type");
+    return chunks[row / capacity]->data + columnOffsets[typeIdx] + infos[typeIdx].size * (row % capacity);
+}
+
+auto Archetype::GetEntity(size_t row) -> Entity {
+    return GetEntities(row / capacity)[row % capacity];
+}
+
+auto Archetype::AllocateRow(Entity entity) -> size_t {
+    if (size == chunks.size() * capacity) {
+        chunks.push_back(std::unique_ptr<Chunk>(new Chunk));
+    }
+    
+    size_t row = size++;
+    GetEntities(row / capacity)[row % capacity] = entity;
+    return row;
+}
+
+void Archetype::RemoveRow(size_t row) {
+    assert(row < size && "Row must exist");
+    
+    if (lockCount > 0) {
+        GetEntities(row / capacity)[row % capacity] = Entity::NULL_ENTITY();
+        pendingRemovals.push_back(row);
+    }
+    else {
+        EraseRow(row);
+    }
+}
+
+void Archetype::EraseRow(size_t row) {
+    size_t lastRow = size - 1;
+    
+    for (size_t i = 0; i < COMPONENT_COUNT; i++) {
+        if (!mask[i]) {
+            continue;
+        }
+        
+        auto type = static_cast<ComponentType>(i);
+        infos[i].destroy(GetComponent(row, type));
+        
+        if (row != lastRow) {
+            void* last = GetComponent(lastRow, type);
+            infos[i].moveConstruct(GetComponent(row, type), last);
+            infos[i].destroy(last);
+        }
+    }
+    
+    if (row != lastRow) {
+        Entity movedEntity = GetEntity(lastRow);
+        GetEntities(row / capacity)[row % capacity] = movedEntity;
+        
+        if (movedEntity.id != Entity::NULL_ID) {
+            entityIdToRow[movedEntity.id] = row;
+        }
+    }
+    
+    size--;
+}
+
+void Archetype::Lock() {
+    lockCount++;
+}
+
+void Archetype::Unlock() {
+    assert(lockCount > 0 && "Archetype must be locked");
+    
+    if (--lockCount > 0 || pendingRemovals.empty()) {
+        return;
+    }
+    
+    // Erasing from the back keeps the rows that are still pending in place
+    std::sort(pendingRemovals.begin(), pendingRemovals.end(), std::greater<>());
+    for (auto row : pendingRemovals) {
+        EraseRow(row);
+    }
+    pendingRemovals.clear();
+}
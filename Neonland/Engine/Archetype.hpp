@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <memory>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+#include "ComponentMask.hpp"
+#include "Entity.hpp"
+
+// Type-erased operations needed to move components between archetypes.
+struct ComponentInfo {
+    size_t size = 0;
+    size_t alignment = 1;
+    void (*moveConstruct)(void* dst, void* src) = nullptr;
+    void (*destroy)(void* ptr) = nullptr;
+    
+    template<Component T>
+    static constexpr auto Of() -> ComponentInfo {
+        return {
+            sizeof(T),
+            alignof(T),
+            [](void* dst, void* src) { new (dst) T(std::move(*static_cast<T*>(src))); },
+            [](void* ptr) { static_cast<T*>(ptr)->~T(); }
+        };
+    }
+};
+
+// Stores every entity with the same ComponentMask in fixed-size chunks.
+// Each chunk holds an entity column followed by one column per component,
+// and all chunks except the last one are always full.
+class Archetype {
+public:
+    static constexpr size_t CHUNK_SIZE = 16 * 1024;
+    
+    const ComponentMask mask;
+    
+    Archetype(ComponentMask mask, const std::array<ComponentInfo, COMPONENT_COUNT>& infos, std::vector<size_t>& entityIdToRow);
+    ~Archetype();
+    
+    Archetype(const Archetype&) = delete;
+    void operator=(const Archetype&) = delete;
+    
+    auto Size() const -> size_t;
+    auto ChunkCount() const -> size_t;
+    auto ChunkCapacity() const -> size_t;
+    auto RowCount(size_t chunkIdx) const -> size_t;
+    
+    auto GetEntities(size_t chunkIdx) -> Entity*;
+    
+    template<Component T>
+    auto GetColumn(size_t chunkIdx) -> T*;
+    
+    template<Component T>
+    auto GetComponent(size_t row) -> T&;
+    auto GetComponent(size_t row, ComponentType type) -> void*;
+    
+    auto GetEntity(size_t row) -> Entity;
+    
+    // The components of the new row are left uninitialized and must be constructed by the caller.
+    auto AllocateRow(Entity entity) -> size_t;
+    
+    // Destroys the components of the row. While the archetype is locked the row is only
+    // marked dead and erased on the last Unlock, so rows never move during iteration.
+    void RemoveRow(size_t row);
+    
+    void Lock();
+    void Unlock();
+private:
+    struct Chunk {
+        alignas(64) std::byte data[CHUNK_SIZE];
+    };
+    
+    static constexpr size_t NO_COLUMN = static_cast<size_t>(-1);
+    
+    std::array<ComponentInfo, COMPONENT_COUNT> infos;
+    std::array<size_t, COMPONENT_COUNT> columnOffsets;
+    size_t capacity;
+    size_t size;
+    
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    std::vector<size_t>& entityIdToRow;
+    
+    size_t lockCount;
+    std::vector<size_t> pendingRemovals;
+    
+    void EraseRow(size_t row);
+};
+
+template<Component T>
+auto Archetype::GetColumn(size_t chunkIdx) -> T* {
+    constexpr auto type = to_underlying(T::componentType);
+    return reinterpret_cast<T*>(chunks[chunkIdx]->data + columnOffsets[type]);
+}
+
+template<Component T>
+auto Archetype::GetComponent(size_t row) -> T& {
+    return GetColumn<T>(row / capacity)[row % capacity];
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <vector>
+#include <tuple>
+#include <future>
+#include <functional>
+#include <concepts>
+#include <utility>
+
+#include "Archetype.hpp"
+#include "ThreadPool.hpp"
+#include "CommandBuffer.hpp"
+
+class IArchetypeGroup {
+public:
+    const ComponentMask requireMask, excludeMask;
+    
+    IArchetypeGroup(ComponentMask require, ComponentMask exclude)
+    : requireMask{require}
+    , excludeMask{exclude & ~require} { }
+    
+    virtual ~IArchetypeGroup() { }
+    
+    auto MatchesGroup(ComponentMask mask) const -> bool {
+        return ((mask & requireMask) == requireMask) && ((mask & excludeMask) == 0);
+    }
+    
+    auto Size() const -> size_t {
+        size_t size = 0;
+        for (auto archetype : archetypes) {
+            size += archetype->Size();
+        }
+        return size;
+    }
+protected:
+    // Archetypes are only ever appended, so iteration can snapshot the count
+    std::vector<Archetype*> archetypes;
+    
+    friend class ArchetypeScene;
+};
+
+// A group in an ArchetypeScene is the list of archetypes matching its masks.
+// Iteration walks the chunks of those archetypes linearly.
+template<Component... Args> requires (sizeof...(Args) > 0) && AllUnique<Args...>
+class ArchetypeGroup : public IArchetypeGroup {
+public:
+    ArchetypeGroup(ComponentMask exclude);
+    
+    // Changed filters and reads are accepted for compatibility with Group, but every member is visited
+    template<typename Filter = Changed<>, typename Func> requires std::invocable<Func, Entity, Args&...>
+    void Update(Func func, ComponentMask reads = {});
+    
+    template<typename Filter = Changed<>, typename Func> requires std::invocable<Func, Entity, Args&...>
+    void UpdateParallel(Func func, ComponentMask reads = {});
+    
+    auto GetMembers() -> std::vector<std::tuple<Entity, Args&...>>;
+    
+    // Same as GetMembers, changes are not tracked
+    auto ReadMembers() -> std::vector<std::tuple<Entity, Args&...>>;
+private:
+    struct ChunkSpan {
+        Archetype* archetype;
+        size_t chunkIdx;
+        size_t rowCount;
+    };
+    
+    // Rows removed while locked stay in place until the last unlock
+    auto LockArchetypes() -> size_t;
+    void UnlockArchetypes(size_t archetypeCount);
+    
+    auto GetChunkSpans(size_t archetypeCount) -> std::vector<ChunkSpan>;
+    
+    template<typename Func> requires std::invocable<Func, Entity, Args&...>
+    static void UpdateChunk(Func& func, ChunkSpan span);
+};
+
+template<Component... Args> requires (sizeof...(Args) > 0) && AllUnique<Args...>
+ArchetypeGroup<Args...>::ArchetypeGroup(ComponentMask exclude)
+: IArchetypeGroup{GetComponentMask<Args...>(), exclude} { }
+
+template<Component... Args> requires (sizeof...(Args) > 0) && AllUnique<Args...>
+template<typename Filter, typename Func> requires std::invocable<Func, Entity, Args&...>
+void ArchetypeGroup<Args...>::Update(Func func, ComponentMask reads) {
+    auto archetypeCount = LockArchetypes();
+    
+    for (auto span : GetChunkSpans(archetypeCount)) {
+        UpdateChunk(func, span);
+    }
+    
+    UnlockArchetypes(archetypeCount);
+}
+
+template<Component... Args> requires (sizeof...(Args) > 0) && AllUnique<Args...>
+template<typename Filter, typename Func> requires std::invocable<Func, Entity, Args&...>
+void ArchetypeGroup<Args...>::UpdateParallel(Func func, ComponentMask reads) {
+    auto archetypeCount = LockArchetypes();
+    auto spans = GetChunkSpans(archetypeCount);
+    
+    // Chunk i records its structural changes into command buffer i of the calling system's set
+    const size_t set = commandBufferSet;
+    
+    ThreadPool::GetInstance().ParallelFor(0, spans.size(), 1, [&func, &spans, set](size_t jobIdx, size_t begin, size_t end) {
+        CommandBufferScope scope{set, jobIdx};
+        
+        for (size_t i = begin; i < end; i++) {
+            UpdateChunk(func, spans[i]);
+        }
+    });
+    
+    UnlockArchetypes(archetypeCount);
+}
+
+template<Component... Args> requires (sizeof...(Args) > 0) && AllUnique<Args...>
+auto ArchetypeGroup<Args...>::GetMembers() -> std::vector<std::tuple<Entity, Args&...>> {
+    std::vector<std::tuple<Entity, Args&...>> members;
+    members.reserve(Size());
+    
+    for (auto span : GetChunkSpans(archetypes.size())) {
+        Entity* entities = span.archetype->GetEntities(span.chunkIdx);
+        std::tuple<Args*...> columns{span.archetype->template GetColumn<Args>(span.chunkIdx)...};
+        
+        for (size_t row = 0; row < span.rowCount; row++) {
+            if (entities[row].id != Entity::NULL_ID) {
+                members.push_back(std::forward_as_tuple(entities[row], std::get<Args*>(columns)[row]...));
+            }
+        }
+    }
+    
+    return members;
+}
+
+template<Component... Args> requires (sizeof...(Args) > 0) && AllUnique<Args...>
+auto ArchetypeGroup<Args...>::ReadMembers() -> std::vector<std::tuple<Entity, Args&...>> {
+    return GetMembers();
+}
+
+template<Component... Args> requires (sizeof...(Args) > 0) && AllUnique<Args...>
+auto ArchetypeGroup<Args...>::LockArchetypes() -> size_t {
+    size_t archetypeCount = archetypes.size();
+    for (size_t i = 0; i < archetypeCount; i++) {
+        archetypes[i]->Lock();
+    }
+    return archetypeCount;
+}
+
+template<Component... Args> requires (sizeof...(Args) > 0) && AllUnique<Args...>
+void ArchetypeGroup<Args...>::UnlockArchetypes(size_t archetypeCount) {
+    for (size_t i = 0; i < archetypeCount; i++) {
+        archetypes[i]->Unlock();
+    }
+}
+
+template<Component... Args> requires (sizeof...(Args) > 0) && AllUnique<Args...>
+auto ArchetypeGroup<Args...>::GetChunkSpans(size_t archetypeCount) -> std::vector<ChunkSpan> {
+    std::vector<ChunkSpan> spans;
+    
+    for (size_t i = 0; i < archetypeCount; i++) {
+        auto archetype = archetypes[i];
+        for (size_t chunkIdx = 0; chunkIdx < archetype->ChunkCount(); chunkIdx++) {
+            spans.push_back({archetype, chunkIdx, archetype->RowCount(chunkIdx)});
+        }
+    }
+    
+    return spans;
+}
+
+template<Component... Args> requires (sizeof...(Args) > 0) && AllUnique<Args...>
+template<typename Func> requires std::invocable<Func, Entity, Args&...>
+void ArchetypeGroup<Args...>::UpdateChunk(Func& func, ChunkSpan span) {
+    Entity* entities = span.archetype->GetEntities(span.chunkIdx);
+    std::tuple<Args*...> columns{span.archetype->template GetColumn<Args>(span.chunkIdx)...};
+    
+    for (size_t row = 0; row < span.rowCount; row++) {
+        // Rows of entities destroyed during the iteration are skipped
+        if (entities[row].id != Entity::NULL_ID) {
+            func(entities[row], std::get<Args*>(columns)[row]...);
+        }
+    }
+}
@@ -0,0 +1,124 @@
+#include "ArchetypeScene.hpp"
+
+ArchetypeScene::ArchetypeScene()
+: nextEntityId{0}
+, releasedEntityCount{0}
+, commandBuffers(ThreadPool::ThreadCount() + 1) {}
+
+void ArchetypeScene::DestroyEntity(Entity entity) {
+    MoveEntity(entity, {});
+    ReleaseEntity(entity);
+}
+
+auto ArchetypeScene::Commands() -> CommandBuffer<ArchetypeScene>& {
+    const size_t jobCount = ThreadPool::ThreadCount() + 1;
+    
+    assert(commandBufferIndex < jobCount && "Command buffer index must be less than the job count");
+    assert((commandBufferSet + 1) * jobCount <= commandBuffers.size() && "Scheduled systems must have reserved command buffers");
+    
+    return commandBuffers[commandBufferSet * jobCount + commandBufferIndex];
+}
+
+void ArchetypeScene::ReserveCommandBuffers(size_t systemCount) {
+    // Set 0 is used outside scheduled systems
+    commandBuffers.resize((systemCount + 1) * (ThreadPool::ThreadCount() + 1));
+}
+
+void ArchetypeScene::FlushCommands() {
+    for (auto& buffer : commandBuffers) {
+        buffer.Playback(*this);
+    }
+}
+
+void ArchetypeScene::NotifyObservers() {
+    observers.Notify(*this);
+}
+
+auto ArchetypeScene::IsAlive(Entity entity) const -> bool {
+    assert(entity.id < sceneEntities.size() && "Entity must be valid");
+    return entity == sceneEntities[entity.id];
+}
+
+auto ArchetypeScene::GetMask(const Entity entity) const -> ComponentMask {
+    assert(IsAlive(entity) && "Entity must be alive");
+    return entityIdToMask[entity.id];
+}
+
+auto ArchetypeScene::ReserveEntity() -> Entity {
+    Entity entity;
+    if (releasedEntityCount == 0) {
+        assert(sceneEntities.size() < Entity::MAX_COUNT && "Number of entities must be less than Entity::MAX_COUNT");
+        entity.id = static_cast<Entity::Id>(sceneEntities.size());
+        entity.version = 0;
+        
+        sceneEntities.push_back(entity);
+        entityIdToMask.push_back({});
+        entityIdToArchetype.push_back(nullptr);
+        entityIdToRow.push_back(0);
+    }
+    else {
+        entity.id = nextEntityId;
+        entity.version = sceneEntities[nextEntityId].version;
+        nextEntityId = sceneEntities[nextEntityId].id;
+        sceneEntities[entity.id] = entity;
+        releasedEntityCount--;
+    }
+    return entity;
+}
+
+void ArchetypeScene::ReleaseEntity(Entity entity) {
+    sceneEntities[entity.id] = {nextEntityId, entity.version + 1};
+    nextEntityId = entity.id;
+    releasedEntityCount++;
+}
+
+auto ArchetypeScene::GetArchetype(ComponentMask mask) -> Archetype* {
+    auto it = maskToArchetype.find(mask);
+    if (it != maskToArchetype.end()) {
+        return it->second;
+    }
+    
+    auto archetype = archetypes.emplace_back(std::make_unique<Archetype>(mask, componentInfos, entityIdToRow)).get();
+    maskToArchetype[mask] = archetype;
+    
+    for (auto& group : groups) {
+        if (group->MatchesGroup(mask)) {
+            group->archetypes.push_back(archetype);
+        }
+    }
+    
+    return archetype;
+}
+
+auto ArchetypeScene::MoveEntity(Entity entity, ComponentMask newMask) -> size_t {
+    auto source = entityIdToArchetype[entity.id];
+    auto sourceRow = entityIdToRow[entity.id];
+    
+    Archetype* destination = newMask.none() ? nullptr : GetArchetype(newMask);
+    size_t destinationRow = destination == nullptr ? 0 : destination->AllocateRow(entity);
+    
+    if (source != nullptr) {
+        if (destination != nullptr) {
+            auto sharedMask = source->mask & newMask;
+            for (size_t i = 0; i < COMPONENT_COUNT; i++) {
+                if (sharedMask[i]) {
+                    auto type = static_cast<ComponentType>(i);
+                    componentInfos[i].moveConstruct(destination->GetComponent(destinationRow, type),
+                                                    source->GetComponent(sourceRow, type));
+                }
+            }
+        }
+        
+        source->RemoveRow(sourceRow);
+    }
+    
+    auto prevMask = entityIdToMask[entity.id];
+    observers.RecordAdd(entity, newMask & ~prevMask);
+    observers.RecordRemove(entity, prevMask & ~newMask);
+    
+    entityIdToArchetype[entity.id] = destination;
+    entityIdToRow[entity.id] = destinationRow;
+    entityIdToMask[entity.id] = newMask;
+    
+    return destinationRow;
+}
@@ -0,0 +1,289 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <algorithm>
+#include <cassert>
+
+#include "ComponentMask.hpp"
+#include "Archetype.hpp"
+#include "ArchetypeGroup.hpp"
+#include "ComponentView.hpp"
+#include "CommandBuffer.hpp"
+#include "Prefab.hpp"
+#include "ComponentObservers.hpp"
+
+// Alternative to Scene that stores entities with the same ComponentMask together
+// in chunked archetype tables instead of one Pool per component type.
+// The public interface matches Scene so game code can use either backend.
+class ArchetypeScene {
+public:
+    ArchetypeScene();
+    
+    // Creating entities
+    template<Component... Args> requires (sizeof...(Args) > 0 && AllUnique<Args...>)
+    auto CreateEntity(Args&&... components) -> Entity;
+    
+    template<Component... Args> requires (sizeof...(Args) > 0 && AllUnique<Args...>)
+    auto CreateEntity() -> Entity;
+    
+    // Creates count copies of the prefab directly into the rows of their archetype
+    template<Component... Args, typename Func> requires std::invocable<Func, size_t, Args&...>
+    auto Instantiate(const Prefab<Args...>& prefab, size_t count, Func initFn) -> std::vector<Entity>;
+    
+    // Destroying entities
+    // Structural changes made while a group is being iterated must go through Commands()
+    void DestroyEntity(Entity entity);
+    
+    // Entity state
+    auto GetMask(Entity entity) const -> ComponentMask;
+    
+    template<Component T>
+    auto Has(Entity entity) const -> bool;
+    
+    auto IsAlive(Entity entity) const -> bool;
+    
+    // Adding components
+    template<Component... Args> requires (sizeof...(Args) > 0 && AllUnique<Args...>)
+    void Add(Entity entity, Args&&... components);
+    
+    template<Component... Args> requires (sizeof...(Args) > 0 && AllUnique<Args...>)
+    void Add(Entity entity);
+    
+    // Removing components
+    template<Component T>
+    void Remove(Entity entity);
+    
+    // Accessing components
+    template<Component T>
+    auto Get(Entity entity) -> T&;
+    
+    // Same as Get, changes are not tracked
+    template<Component T>
+    auto Read(Entity entity) -> T&;
+    
+    template<Component T>
+    auto GetPool() -> std::shared_ptr<ComponentView<T>>;
+    
+    // Changes are not tracked, filtered updates visit every member
+    template<Component T>
+    void MarkChanged(Entity entity) { }
+    
+    // Observers
+    template<Component T>
+    void OnAdd(ComponentObservers::Callback callback);
+    
+    template<Component T>
+    void OnRemove(ComponentObservers::Callback callback);
+    
+    void NotifyObservers();
+    
+    // Groups
+    template<Component... Args> requires (sizeof...(Args) > 0 && AllUnique<Args...>)
+    auto GetGroup(ComponentMask exclude = {}) -> std::shared_ptr<ArchetypeGroup<Args...>>;
+    
+    // Archetype columns are already packed, so owning groups are plain groups here
+    template<Component... Args> requires (sizeof...(Args) > 0 && AllUnique<Args...>)
+    auto GetOwningGroup(ComponentMask exclude = {}) -> std::shared_ptr<ArchetypeGroup<Args...>>;
+    
+    // Deferred structural changes
+    // Returns the command buffer of the calling UpdateParallel job, in the set of the calling system
+    auto Commands() -> CommandBuffer<ArchetypeScene>&;
+    
+    // Gives each of systemCount scheduled systems its own set of buffers, so systems that run
+    // concurrently do not share them
+    void ReserveCommandBuffers(size_t systemCount);
+    
+    // Plays back the recorded commands in system and then job order. Must not be called while iterating.
+    void FlushCommands();
+private:
+    Entity::Id nextEntityId;
+    size_t releasedEntityCount;
+    
+    std::vector<Entity> sceneEntities;
+    
+    std::vector<CommandBuffer<ArchetypeScene>> commandBuffers;
+    
+    std::vector<ComponentMask> entityIdToMask;
+    std::vector<Archetype*> entityIdToArchetype;
+    std::vector<size_t> entityIdToRow;
+    
+    std::array<ComponentInfo, COMPONENT_COUNT> componentInfos;
+    
+    std::vector<std::unique_ptr<Archetype>> archetypes;
+    std::unordered_map<ComponentMask, Archetype*> maskToArchetype;
+    
+    std::vector<std::shared_ptr<IArchetypeGroup>> groups;
+    
+    ComponentObservers observers;
+    
+    auto ReserveEntity() -> Entity;
+    void ReleaseEntity(Entity entity);
+    
+    auto GetArchetype(ComponentMask mask) -> Archetype*;
+    
+    // Moves the entity's components to the archetype of newMask, dropping the ones not in it.
+    // Returns the row of the entity in its new archetype.
+    auto MoveEntity(Entity entity, ComponentMask newMask) -> size_t;
+    
+    template<Component T, Component... Args>
+    void ConstructComponents(Archetype& archetype, size_t row, T&& component, Args&&... components);
+};
+
+template<Component... Args> requires (sizeof...(Args) > 0 && AllUnique<Args...>)
+auto ArchetypeScene::CreateEntity(Args&&... components) -> Entity {
+    auto entity = ReserveEntity();
+    Add(entity, std::forward<Args>(components)...);
+    return entity;
+}
+
+template<Component... Args> requires (sizeof...(Args) > 0 && AllUnique<Args...>)
+auto ArchetypeScene::CreateEntity() -> Entity {
+    return CreateEntity(Args()...);
+}
+
+template<Component... Args, typename Func> requires std::invocable<Func, size_t, Args&...>
+auto ArchetypeScene::Instantiate(const Prefab<Args...>& prefab, size_t count, Func initFn) -> std::vector<Entity> {
+    std::vector<Entity> entities;
+    entities.reserve(count);
+    
+    ((componentInfos[to_underlying(Args::componentType)] = ComponentInfo::Of<Args>()), ...);
+    
+    const auto mask = GetComponentMask<Args...>();
+    auto archetype = GetArchetype(mask);
+    
+    for (size_t i = 0; i < count; i++) {
+        auto entity = ReserveEntity();
+        auto row = archetype->AllocateRow(entity);
+        
+        auto instance = prefab.components;
+        std::apply([&](Args&... components) {
+            initFn(i, components...);
+            ConstructComponents(*archetype, row, std::move(components)...);
+        }, instance);
+        
+        entityIdToArchetype[entity.id] = archetype;
+        entityIdToRow[entity.id] = row;
+        entityIdToMask[entity.id] = mask;
+        
+        entities.push_back(entity);
+    }
+    
+    observers.RecordAdd(entities, mask);
+    
+    return entities;
+}
+
+template<Component T>
+auto ArchetypeScene::Has(Entity entity) const -> bool {
+    return GetMask(entity)[to_underlying(T::componentType)];
+}
+
+template<Component... Args> requires (sizeof...(Args) > 0 && AllUnique<Args...>)
+void ArchetypeScene::Add(Entity entity, Args&&... components) {
+    assert(IsAlive(entity) && "Entity must be alive");
+    
+    auto addedMask = GetComponentMask<Args...>();
+    assert((entityIdToMask[entity.id] & addedMask).none() && "Component cannot be added twice");
+    
+    ((componentInfos[to_underlying(Args::componentType)] = ComponentInfo::Of<Args>()), ...);
+    
+    auto row = MoveEntity(entity, entityIdToMask[entity.id] | addedMask);
+    ConstructComponents(*entityIdToArchetype[entity.id], row, std::forward<Args>(components)...);
+}
+
+template<Component... Args> requires (sizeof...(Args) > 0 && AllUnique<Args...>)
+void ArchetypeScene::Add(Entity entity) {
+    Add(entity, Args()...);
+}
+
+template<Component T>
+void ArchetypeScene::Remove(Entity entity) {
+    assert(IsAlive(entity) && "Entity must be alive");
+    assert(Has<T>(entity) && "Entity must have the specified component");
+    MoveEntity(entity, entityIdToMask[entity.id] & ~GetComponentMask<T>());
+}
+
+template<Component T>
+auto ArchetypeScene::Get(Entity entity) -> T& {
+    assert(IsAlive(entity) && "Entity must be alive");
+    return entityIdToArchetype[entity.id]->GetComponent<T>(entityIdToRow[entity.id]);
+}
+
+template<Component T>
+auto ArchetypeScene::Read(Entity entity) -> T& {
+    return Get<T>(entity);
+}
+
+template<Component T>
+void ArchetypeScene::OnAdd(ComponentObservers::Callback callback) {
+    observers.OnAdd(T::componentType, std::move(callback));
+}
+
+template<Component T>
+void ArchetypeScene::OnRemove(ComponentObservers::Callback callback) {
+    observers.OnRemove(T::componentType, std::move(callback));
+}
+
+template<Component T>
+auto ArchetypeScene::GetPool() -> std::shared_ptr<ComponentView<T>> {
+    auto view = std::make_shared<ComponentView<T>>();
+    
+    for (auto& archetype : archetypes) {
+        if (!archetype->mask[to_underlying(T::componentType)]) {
+            continue;
+        }
+        
+        for (size_t chunkIdx = 0; chunkIdx < archetype->ChunkCount(); chunkIdx++) {
+            Entity* entities = archetype->GetEntities(chunkIdx);
+            T* column = archetype->GetColumn<T>(chunkIdx);
+            
+            for (size_t row = 0; row < archetype->RowCount(chunkIdx); row++) {
+                if (entities[row].id != Entity::NULL_ID) {
+                    view->components.push_back(&column[row]);
+                }
+            }
+        }
+    }
+    
+    return view;
+}
+
+template<Component... Args> requires (sizeof...(Args) > 0 && AllUnique<Args...>)
+auto ArchetypeScene::GetGroup(ComponentMask exclude) -> std::shared_ptr<ArchetypeGroup<Args...>> {
+    auto require = GetComponentMask<Args...>();
+    exclude = exclude & ~require;
+    
+    for (auto group : groups) {
+        if (group->requireMask == require && group->excludeMask == exclude) {
+            return std::static_pointer_cast<ArchetypeGroup<Args...>>(group);
+        }
+    }
+    
+    auto group = std::make_shared<ArchetypeGroup<Args...>>(exclude);
+    
+    for (auto& archetype : archetypes) {
+        if (group->MatchesGroup(archetype->mask)) {
+            group->archetypes.push_back(archetype.get());
+        }
+    }
+    
+    groups.push_back(group);
+    return group;
+}
+
+template<Component... Args> requires (sizeof...(Args) > 0 && AllUnique<Args...>)
+auto ArchetypeScene::GetOwningGroup(ComponentMask exclude) -> std::shared_ptr<ArchetypeGroup<Args...>> {
+    return GetGroup<Args...>(exclude);
+}
+
+template<Component T, Component... Args>
+void ArchetypeScene::ConstructComponents(Archetype& archetype, size_t row, T&& component, Args&&... components) {
+    new (&archetype.GetComponent<T>(row)) T(std::forward<T>(component));
+    
+    if constexpr (sizeof...(Args) > 0) {
+        ConstructComponents(archetype, row, std::forward<Args>(components)...);
+    }
+}
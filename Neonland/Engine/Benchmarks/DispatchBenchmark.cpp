@@ -0,0 +1,188 @@
+// Measures job dispatch on ThreadPool against the single locked queue it replaced.
+// Built from the repository root with
+//     clang++ -std=c++20 -O2 -pthread -DNDEBUG Neonland/Engine/Benchmarks/DispatchBenchmark.cpp
+//         Neonland/Engine/ThreadPool.cpp -o DispatchBenchmark
+// ThreadPool is configured once per process, so each run covers one worker count:
+//     for threads in 1 4 16 64; do ./DispatchBenchmark $threads; done
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include <queue>
+#include <memory>
+#include <algorithm>
+
+#include "../ThreadPool.hpp"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+    
+    // The pool before the work-stealing deques: one queue behind one mutex, one wakeup per job
+    class LockedQueuePool {
+    public:
+        explicit LockedQueuePool(uint32_t threadCount)
+        : destructing{false} {
+            for (uint32_t i = 0; i < threadCount; i++) {
+                threads.push_back(std::thread(&LockedQueuePool::ThreadLoop, this));
+            }
+        }
+        
+        ~LockedQueuePool() {
+            {
+                std::unique_lock lock(jobMutex);
+                destructing = true;
+            }
+            
+            jobCondition.notify_all();
+            
+            for (auto& thread : threads) {
+                thread.join();
+            }
+        }
+        
+        std::future<void> SubmitJob(std::function<void()> func) {
+            auto task = std::make_shared<std::packaged_task<void()>>(func);
+            
+            {
+                std::unique_lock lock(jobMutex);
+                jobs.push([task] { (*task)(); });
+            }
+            
+            jobCondition.notify_one();
+            
+            return task->get_future();
+        }
+    private:
+        std::vector<std::thread> threads;
+        std::queue<std::function<void()>> jobs;
+        
+        std::mutex jobMutex;
+        std::condition_variable jobCondition;
+        
+        bool destructing;
+        
+        void ThreadLoop() {
+            while (true) {
+                std::function<void()> job;
+                
+                {
+                    std::unique_lock lock(jobMutex);
+                    jobCondition.wait(lock, [this] { return !jobs.empty() || destructing; });
+                    
+                    if (destructing && jobs.empty()) {
+                        return;
+                    }
+                    
+                    job = jobs.front();
+                    jobs.pop();
+                }
+                
+                job();
+            }
+        }
+    };
+    
+    void WaitFor(const std::atomic<size_t>& done, size_t count) {
+        while (done.load(std::memory_order_acquire) < count) {
+            std::this_thread::yield();
+        }
+    }
+    
+    // Empty jobs per second, all submitted by the main thread
+    template<typename Pool>
+    auto ExternalThroughput(Pool& pool, size_t jobCount) -> double {
+        std::atomic<size_t> done{0};
+        
+        const auto start = Clock::now();
+        for (size_t i = 0; i < jobCount; i++) {
+            pool.SubmitJob([&done] { done.fetch_add(1, std::memory_order_release); });
+        }
+        WaitFor(done, jobCount);
+        
+        return jobCount / std::chrono::duration<double>(Clock::now() - start).count();
+    }
+    
+    // Empty jobs per second, submitted by jobs running on the workers as the tick systems do
+    template<typename Pool>
+    auto NestedThroughput(Pool& pool, size_t jobCount) -> double {
+        constexpr size_t fanOut = 64;
+        const size_t parentCount = jobCount / fanOut;
+        std::atomic<size_t> done{0};
+        
+        const auto start = Clock::now();
+        for (size_t i = 0; i < parentCount; i++) {
+            pool.SubmitJob([&pool, &done] {
+                for (size_t j = 0; j < fanOut; j++) {
+                    pool.SubmitJob([&done] { done.fetch_add(1, std::memory_order_release); });
+                }
+            });
+        }
+        WaitFor(done, parentCount * fanOut);
+        
+        return parentCount * fanOut / std::chrono::duration<double>(Clock::now() - start).count();
+    }
+    
+    struct Latency {
+        double averageUs;
+        double p99Us;
+    };
+    
+    // Time from submit to start of single jobs, with the workers idle in between
+    template<typename Pool>
+    auto IdleLatency(Pool& pool, size_t rounds) -> Latency {
+        std::vector<double> latencies;
+        latencies.reserve(rounds);
+        
+        for (size_t i = 0; i < rounds; i++) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            
+            Clock::time_point started;
+            const auto submitted = Clock::now();
+            pool.SubmitJob([&started] { started = Clock::now(); }).wait();
+            
+            latencies.push_back(std::chrono::duration<double, std::micro>(started - submitted).count());
+        }
+        
+        std::sort(latencies.begin(), latencies.end());
+        
+        double sum = 0;
+        for (double latency : latencies) {
+            sum += latency;
+        }
+        
+        return {sum / rounds, latencies[rounds * 99 / 100]};
+    }
+    
+    template<typename Pool>
+    void Report(const char* name, Pool& pool) {
+        const double external = ExternalThroughput(pool, 200000);
+        const double nested = NestedThroughput(pool, 200000);
+        const auto latency = IdleLatency(pool, 2000);
+        
+        std::printf("  %-13s external %6.2f Mjobs/s  nested %6.2f Mjobs/s  idle latency %7.1f us avg %7.1f us p99\n",
+                    name,
+                    external * 1e-6,
+                    nested * 1e-6,
+                    latency.averageUs,
+                    latency.p99Us);
+    }
+}
+
+int main(int argc, char** argv) {
+    const uint32_t threadCount = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 4;
+    
+    ThreadPool::Configure({threadCount, 0, {}, {}});
+    
+    std::printf("%u threads\n", threadCount);
+    
+    {
+        LockedQueuePool pool(threadCount);
+        Report("locked queue", pool);
+    }
+    
+    Report("work stealing", ThreadPool::GetInstance());
+    
+    return 0;
+}
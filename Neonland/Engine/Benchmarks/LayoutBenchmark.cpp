@@ -0,0 +1,155 @@
+// Compares the Physics and Transform passes of a tick on AoS structs and on their SoA columns.
+// Built from the repository root with
+//     clang++ -std=c++20 -O2 -DNDEBUG Neonland/Engine/Benchmarks/LayoutBenchmark.cpp
+//         Neonland/Components/Physics.cpp Neonland/Components/Transform.cpp Neonland/NeonConstants.cpp
+//         Neonland/Engine/SimdKernels.cpp Neonland/Engine/MathUtils.cpp Neonland/Engine/Frustum.cpp
+//         -o LayoutBenchmark
+// Bytes per body are those of the cache lines a pass streams: whole structs in AoS, the columns
+// of the fields it touches in SoA. Bandwidth is those bytes over the time of the pass.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "../SimdKernels.hpp"
+#include "../../Components/Physics.hpp"
+#include "../../Components/Transform.hpp"
+
+namespace {
+    constexpr float timestep = 1.0f / 60;
+    
+    struct Bodies {
+        std::vector<Physics> physics;
+        std::vector<Transform> transforms;
+        
+        PhysicsColumns physicsColumns;
+        TransformColumns transformColumns;
+        
+        size_t count;
+    };
+    
+    auto MakeBodies(size_t count) -> Bodies {
+        Bodies bodies;
+        bodies.count = count;
+        bodies.physics.reserve(count);
+        bodies.transforms.reserve(count);
+        bodies.physicsColumns.Reserve(count);
+        bodies.transformColumns.Reserve(count);
+        
+        for (size_t i = 0; i < count; i++) {
+            const float angle = i * 0.1f;
+            Transform tf({std::cos(angle) * i * 0.01f, std::sin(angle) * i * 0.01f, 0});
+            Physics physics(tf, {std::sin(angle), std::cos(angle), 0}, {0, 0, 90});
+            
+            bodies.transforms.push_back(tf);
+            bodies.physics.push_back(physics);
+            bodies.transformColumns.PushBack(tf);
+            bodies.physicsColumns.PushBack(physics);
+        }
+        
+        return bodies;
+    }
+    
+    // Integrates every body as IntegratePhysics does
+    void IntegrateAoS(Bodies& bodies) {
+        for (size_t i = 0; i < bodies.count; i++) {
+            Physics::Update(bodies.physics[i], bodies.transforms[i], timestep);
+        }
+    }
+    
+    void IntegrateSoA(Bodies& bodies) {
+        auto& tf = bodies.transformColumns;
+        auto& physics = bodies.physicsColumns;
+        
+        for (size_t i = 0; i < bodies.count; i++) {
+            if (tf.At<&Transform::teleported>(i)) {
+                physics.At<&Physics::position>(i) = tf.At<&Transform::position>(i);
+                tf.At<&Transform::teleported>(i) = false;
+            }
+            
+            if (tf.At<&Transform::rotationSet>(i)) {
+                physics.At<&Physics::rotation>(i) = tf.At<&Transform::rotation>(i);
+                tf.At<&Transform::rotationSet>(i) = false;
+            }
+        }
+        
+        auto Integrate = [&](SoAColumn<float3>& values, SoAColumn<float3>& previous, SoAColumn<float3>& rates) {
+            IntegrateArray(values.X(), previous.X(), rates.X(), timestep, bodies.count);
+            IntegrateArray(values.Y(), previous.Y(), rates.Y(), timestep, bodies.count);
+            IntegrateArray(values.Z(), previous.Z(), rates.Z(), timestep, bodies.count);
+        };
+        
+        Integrate(physics.Column<&Physics::position>(), physics.Column<&Physics::prevPosition>(), physics.Column<&Physics::velocity>());
+        Integrate(physics.Column<&Physics::rotation>(), physics.Column<&Physics::prevRotation>(), physics.Column<&Physics::angularVelocity>());
+    }
+    
+    // Steers every body towards the origin as SteerEnemies does
+    void ChaseAoS(Bodies& bodies) {
+        for (auto& physics : bodies.physics) {
+            float3 dir = -physics.position;
+            dir.z = 0;
+            dir = VecNormalize(dir);
+            physics.velocity = physics.velocity + dir * 0.1f;
+            physics.rotation.z = std::atan2(dir.y, dir.x) * RadToDeg;
+        }
+    }
+    
+    void ChaseSoA(Bodies& bodies) {
+        auto& physics = bodies.physicsColumns;
+        
+        for (size_t i = 0; i < bodies.count; i++) {
+            Float3Ref position = physics.At<&Physics::position>(i);
+            Float3Ref velocity = physics.At<&Physics::velocity>(i);
+            
+            float3 dir = -position;
+            dir.z = 0;
+            dir = VecNormalize(dir);
+            velocity = velocity + dir * 0.1f;
+            physics.At<&Physics::rotation>(i).z = std::atan2(dir.y, dir.x) * RadToDeg;
+        }
+    }
+    
+    // Runs pass until about a tenth of a second has passed, returns the seconds per run
+    template<typename Pass>
+    auto Time(Bodies& bodies, Pass pass) -> double {
+        pass(bodies);
+        
+        int runs = 0;
+        const auto start = std::chrono::steady_clock::now();
+        double elapsed = 0;
+        do {
+            pass(bodies);
+            runs++;
+            elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        } while (elapsed < 0.1);
+        
+        return elapsed / runs;
+    }
+    
+    void Report(const char* name, size_t count, size_t bytesPerBody, double seconds) {
+        std::printf("  %-14s %4zu B/body  %8.3f ms  %6.2f GB/s\n",
+                    name, bytesPerBody, seconds * 1e3, bytesPerBody * count / seconds * 1e-9);
+    }
+}
+
+int main() {
+    std::printf("Kernels: %s\n", SimdKernelTarget());
+    
+    // The integrate pass reads and writes six float3 fields and the two flags,
+    // the chase pass position, velocity and rotation
+    const size_t integrateSoABytes = 6 * 3 * sizeof(float) + 2 * sizeof(bool);
+    const size_t chaseSoABytes = 3 * 3 * sizeof(float);
+    
+    for (size_t count : {4096, 65536, 1048576}) {
+        Bodies bodies = MakeBodies(count);
+        
+        std::printf("%zu bodies\n", count);
+        Report("integrate AoS", count, sizeof(Physics) + sizeof(Transform), Time(bodies, IntegrateAoS));
+        Report("integrate SoA", count, integrateSoABytes, Time(bodies, IntegrateSoA));
+        Report("chase AoS", count, sizeof(Physics), Time(bodies, ChaseAoS));
+        Report("chase SoA", count, chaseSoABytes, Time(bodies, ChaseSoA));
+    }
+    
+    return 0;
+}
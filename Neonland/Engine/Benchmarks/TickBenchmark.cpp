@@ -0,0 +1,140 @@
+// Times NeonScene::Tick on a level with scripted input, on the storage backend it is built with.
+// Build it once per backend from the repository root and compare the two runs:
+//     clang++ -std=c++20 -O2 -pthread -DNDEBUG Neonland/Engine/Benchmarks/TickBenchmark.cpp
+//         $(ls Neonland/*.cpp Neonland/Components/*.cpp Neonland/Engine/*.cpp | grep -v Neonland/Neonland.cpp)
+//         -o TickBenchmark
+//     the same with -DNEON_ARCHETYPE_STORAGE -o TickBenchmarkArchetype
+// Usage: TickBenchmark [seconds] [level]
+// The backends visit entities in different orders, so the runs play out differently after a while.
+// Compare the time per enemy as well as the time per tick.
+// TickBenchmark collision [seconds] [level] plays the level at 60 down to 10 ticks per second with
+// continuous collision off and on, and reports the shots, the kills and the tick cost of each run.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include "../../NeonScene.hpp"
+
+class TickBenchmark {
+public:
+    struct Result {
+        int tickCount = 0;
+        double tickSeconds = 0;
+        double enemyTicks = 0;
+        int shots = 0;
+        int kills = 0;
+    };
+    
+    // Plays level for the given game time, ticking every timestep seconds
+    static auto Run(int level, double timestep, double seconds, bool continuousCollision) -> Result {
+        NeonScene scene(MAX_INSTANCE_COUNT, timestep);
+        for (auto& size : scene.textureSizes) {
+            size = {64, 32};
+        }
+        scene.randomEngine.seed(42);
+        scene.continuousCollision = continuousCollision;
+        
+        scene.Start();
+        scene.LoadLevel(level);
+        
+        Result result;
+        int weaponIdx = -1;
+        int remaining = scene.enemiesRemainingField.GetValue();
+        
+        for (double time = timestep; time <= seconds; time += timestep) {
+            // Fires in bursts while circling and strafing, switching weapons now and then.
+            // Scripted by game time so runs at different tick rates get the same input.
+            scene.mouseDown = std::fmod(time, 5.0) < 3.33;
+            scene.mousePos = {float(std::sin(time * 1.5) * 0.8), float(std::cos(time * 0.9) * 0.8)};
+            scene.moveDir = {float(std::sin(time * 0.3)), float(std::cos(time * 0.39)), 0};
+            if (static_cast<int>(time / 13.33) % 3 != weaponIdx) {
+                weaponIdx = static_cast<int>(time / 13.33) % 3;
+                scene.SelectWeapon(weaponIdx);
+            }
+            
+            // Keeps the player alive so every run lasts the whole time
+            scene._scene.Get<HP>(scene.player).Set(100);
+            
+            const double cooldownEndTime = scene.CurrentWeapon().cooldownEndTime;
+            
+            const auto start = std::chrono::steady_clock::now();
+            scene.Tick(time);
+            const auto end = std::chrono::steady_clock::now();
+            
+            result.tickCount++;
+            result.tickSeconds += std::chrono::duration<double>(end - start).count();
+            result.enemyTicks += scene._scene.GetGroup<Physics, Enemy>()->Size();
+            
+            if (scene.CurrentWeapon().cooldownEndTime != cooldownEndTime) {
+                result.shots += scene.CurrentWeapon().projectilesPerShot;
+            }
+            
+            // The count goes up when the next wave starts
+            const int newRemaining = scene.enemiesRemainingField.GetValue();
+            result.kills += std::max(remaining - newRemaining, 0);
+            remaining = newRemaining;
+        }
+        
+        return result;
+    }
+};
+
+namespace {
+    void CompareBackends(int level, double seconds) {
+#ifdef NEON_ARCHETYPE_STORAGE
+        const char* backend = "archetype";
+#else
+        const char* backend = "sparse set";
+#endif
+        
+        const auto result = TickBenchmark::Run(level, TIMESTEP, seconds, true);
+        
+        std::printf("%s storage, level %d, %d ticks\n", backend, level, result.tickCount);
+        std::printf("%.3f ms/tick, %.1f enemies/tick, %.1f ns/enemy\n",
+                    result.tickSeconds / result.tickCount * 1e3,
+                    result.enemyTicks / result.tickCount,
+                    result.tickSeconds / result.enemyTicks * 1e9);
+    }
+    
+    // The tick rate also changes how often the weapons fire and how the enemies move, so the runs are
+    // compared by kills per shot against the 60 Hz run. Projectiles passing through enemies lower them.
+    void CompareCollision(int level, double seconds) {
+        std::printf("level %d, %.0f s of play\n", level, seconds);
+        
+        for (int rate : {60, 30, 20, 15, 10}) {
+            for (bool continuousCollision : {false, true}) {
+                const auto result = TickBenchmark::Run(level, 1.0 / rate, seconds, continuousCollision);
+                
+                std::printf("  %2d Hz, continuous collision %-3s  %5d shots  %4d kills  %5.1f kills/100 shots  %.3f ms/tick  %.3f ms per game second\n",
+                            rate,
+                            continuousCollision ? "on" : "off",
+                            result.shots,
+                            result.kills,
+                            result.kills * 100.0 / std::max(result.shots, 1),
+                            result.tickSeconds / result.tickCount * 1e3,
+                            result.tickSeconds / seconds * 1e3);
+            }
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    const bool collision = argc > 1 && std::strcmp(argv[1], "collision") == 0;
+    const int argOffset = collision ? 1 : 0;
+    
+    const double seconds = argc > 1 + argOffset ? std::atof(argv[1 + argOffset]) : 100;
+    const int level = argc > 2 + argOffset ? std::atoi(argv[2 + argOffset]) : 1;
+    
+    if (collision) {
+        CompareCollision(level, seconds);
+    }
+    else {
+        CompareBackends(level, seconds);
+    }
+    
+    return 0;
+}
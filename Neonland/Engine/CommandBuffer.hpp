@@ -0,0 +1,112 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <utility>
+
+#include "Entity.hpp"
+#include "ComponentMask.hpp"
+
+// Index of the UpdateParallel job running on the calling thread, 0 outside parallel updates.
+// Each job records into its own buffer, so playback order does not depend on scheduling.
+inline thread_local size_t commandBufferIndex = 0;
+
+// Buffers of the scheduled system running on the calling thread, 0 outside SystemScheduler.
+// Systems that run concurrently record into different sets, which play back in registration order.
+inline thread_local size_t commandBufferSet = 0;
+
+// Makes the calling thread record into buffer index of set until the scope ends.
+// The previous buffer is restored because a waiting thread can run another update's job.
+class CommandBufferScope {
+public:
+    CommandBufferScope(size_t set, size_t index)
+    : previousSet{std::exchange(commandBufferSet, set)}
+    , previousIndex{std::exchange(commandBufferIndex, index)} { }
+    
+    ~CommandBufferScope() {
+        commandBufferSet = previousSet;
+        commandBufferIndex = previousIndex;
+    }
+    
+    CommandBufferScope(const CommandBufferScope&) = delete;
+    auto operator=(const CommandBufferScope&) -> CommandBufferScope& = delete;
+private:
+    size_t previousSet;
+    size_t previousIndex;
+};
+
+// Records structural changes made while groups are being iterated.
+// A buffer is only written by one job at a time, so recording needs no locking.
+template<typename SceneType>
+class CommandBuffer {
+public:
+    void DestroyEntity(Entity entity);
+    
+    template<Component... Args> requires (sizeof...(Args) > 0 && AllUnique<Args...>)
+    void CreateEntity(Args&&... components);
+    
+    template<Component... Args> requires (sizeof...(Args) > 0 && AllUnique<Args...>)
+    void Add(Entity entity, Args&&... components);
+    
+    template<Component T>
+    void Remove(Entity entity);
+    
+    // Applies the commands in recording order. Commands targeting entities
+    // that are no longer alive are skipped.
+    void Playback(SceneType& scene);
+private:
+    struct Command {
+        Entity entity;
+        // Empty for destroy commands, which are the common case and need no allocation
+        std::function<void(SceneType&)> apply;
+    };
+    
+    std::vector<Command> commands;
+};
+
+template<typename SceneType>
+void CommandBuffer<SceneType>::DestroyEntity(Entity entity) {
+    commands.push_back({entity, nullptr});
+}
+
+template<typename SceneType>
+template<Component... Args> requires (sizeof...(Args) > 0 && AllUnique<Args...>)
+void CommandBuffer<SceneType>::CreateEntity(Args&&... components) {
+    commands.push_back({Entity::NULL_ENTITY(), [...components = std::forward<Args>(components)](SceneType& scene) mutable {
+        scene.CreateEntity(std::move(components)...);
+    }});
+}
+
+template<typename SceneType>
+template<Component... Args> requires (sizeof...(Args) > 0 && AllUnique<Args...>)
+void CommandBuffer<SceneType>::Add(Entity entity, Args&&... components) {
+    commands.push_back({entity, [entity, ...components = std::forward<Args>(components)](SceneType& scene) mutable {
+        scene.Add(entity, std::move(components)...);
+    }});
+}
+
+template<typename SceneType>
+template<Component T>
+void CommandBuffer<SceneType>::Remove(Entity entity) {
+    commands.push_back({entity, [entity](SceneType& scene) {
+        scene.template Remove<T>(entity);
+    }});
+}
+
+template<typename SceneType>
+void CommandBuffer<SceneType>::Playback(SceneType& scene) {
+    for (auto& command : commands) {
+        if (command.entity.id != Entity::NULL_ID && !scene.IsAlive(command.entity)) {
+            continue;
+        }
+        
+        if (command.apply) {
+            command.apply(scene);
+        }
+        else {
+            scene.DestroyEntity(command.entity);
+        }
+    }
+    
+    commands.clear();
+}
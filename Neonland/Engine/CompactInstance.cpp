@@ -0,0 +1,119 @@
+#include "CompactInstance.hpp"
+
+#include <bit>
+#include <cmath>
+#include <algorithm>
+
+namespace {
+    constexpr float degreesPerStep = 360.0f / 65536.0f;
+    
+    // Whole turns are removed, the rest is rounded to a step. The conversion keeps it modulo one turn.
+    auto EncodeAngle(float degrees) -> uint16_t {
+        const float turns = std::nearbyint(degrees * (1.0f / 360));
+        const float steps = std::nearbyint((degrees - turns * 360) * (65536.0f / 360));
+        return static_cast<uint16_t>(static_cast<int32_t>(steps));
+    }
+    
+    auto EncodeChannel(float value) -> uint32_t {
+        return static_cast<uint32_t>(std::nearbyint(std::clamp(value, 0.0f, 1.0f) * 255));
+    }
+    
+    auto DecodeChannel(uint32_t color, int shift) -> float {
+        return static_cast<float>((color >> shift) & 0xff) / 255;
+    }
+}
+
+auto FloatToHalf(float value) -> uint16_t {
+    const uint32_t bits = std::bit_cast<uint32_t>(value);
+    const auto sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    const uint32_t magnitude = bits & 0x7fffffff;
+    
+    // NaN, and 65536 up to infinity. Values from 65520 round up to infinity below.
+    if (magnitude >= 0x47800000) {
+        return sign | (magnitude > 0x7f800000 ? 0x7e00 : 0x7c00);
+    }
+    
+    // Below the smallest normal half, adding 0.5 leaves the value rounded to a multiple of 2^-24,
+    // to nearest even, in the low mantissa bits
+    if (magnitude < 0x38800000) {
+        const float subnormal = std::bit_cast<float>(magnitude) + 0.5f;
+        return sign | static_cast<uint16_t>(std::bit_cast<uint32_t>(subnormal) - std::bit_cast<uint32_t>(0.5f));
+    }
+    
+    // Rebias the exponent from 127 to 15 and round the mantissa to 10 bits, carrying into the exponent
+    const uint32_t rebiased = magnitude - (112u << 23);
+    return sign | static_cast<uint16_t>((rebiased + 0xfff + ((rebiased >> 13) & 1)) >> 13);
+}
+
+auto HalfToFloat(uint16_t half) -> float {
+    const uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+    const uint32_t exponent = (half >> 10) & 0x1f;
+    const uint32_t mantissa = half & 0x3ff;
+    
+    if (exponent == 0) {
+        const float subnormal = static_cast<float>(mantissa) / 16777216;
+        return sign != 0 ? -subnormal : subnormal;
+    }
+    
+    if (exponent == 0x1f) {
+        return std::bit_cast<float>(sign | 0x7f800000 | (mantissa << 13));
+    }
+    
+    return std::bit_cast<float>(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+auto EncodeCompactInstance(float3 position, float3 rotation, float3 scale, float4 color) -> CompactInstance {
+    CompactInstance instance;
+    
+    instance.position[0] = position.x;
+    instance.position[1] = position.y;
+    instance.position[2] = position.z;
+    
+    instance.color = EncodeChannel(color.x)
+                   | EncodeChannel(color.y) << 8
+                   | EncodeChannel(color.z) << 16
+                   | EncodeChannel(color.w) << 24;
+    
+    instance.rotation[0] = EncodeAngle(rotation.x);
+    instance.rotation[1] = EncodeAngle(rotation.y);
+    instance.rotation[2] = EncodeAngle(rotation.z);
+    
+    instance.scale[0] = FloatToHalf(scale.x);
+    instance.scale[1] = FloatToHalf(scale.y);
+    instance.scale[2] = FloatToHalf(scale.z);
+    
+    return instance;
+}
+
+void DecodeCompactInstances(const CompactInstance* instances, size_t count, Instance* out) {
+    InstanceBlock block = {};
+    
+    for (size_t begin = 0; begin < count; begin += InstanceBlock::capacity) {
+        const size_t size = std::min(InstanceBlock::capacity, count - begin);
+        
+        for (size_t i = 0; i < size; i++) {
+            const CompactInstance& instance = instances[begin + i];
+            
+            block.positionX[i] = instance.position[0];
+            block.positionY[i] = instance.position[1];
+            block.positionZ[i] = instance.position[2];
+            block.rotationX[i] = instance.rotation[0] * degreesPerStep;
+            block.rotationY[i] = instance.rotation[1] * degreesPerStep;
+            block.rotationZ[i] = instance.rotation[2] * degreesPerStep;
+            block.scaleX[i] = HalfToFloat(instance.scale[0]);
+            block.scaleY[i] = HalfToFloat(instance.scale[1]);
+            block.scaleZ[i] = HalfToFloat(instance.scale[2]);
+            
+            block.colorR[i] = DecodeChannel(instance.color, 0);
+            block.colorG[i] = DecodeChannel(instance.color, 8);
+            block.colorB[i] = DecodeChannel(instance.color, 16);
+            block.colorA[i] = DecodeChannel(instance.color, 24);
+            block.tintR[i] = 1;
+            block.tintG[i] = 1;
+            block.tintB[i] = 1;
+            block.tintA[i] = 1;
+        }
+        
+        ComposeInstances(block, size, out + begin);
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ShaderTypes.h"
+#include "MathUtils.hpp"
+#include "SimdKernels.hpp"
+
+// IEEE half floats, rounded to nearest even. Values too large for a half become infinity.
+auto FloatToHalf(float value) -> uint16_t;
+auto HalfToFloat(uint16_t half) -> float;
+
+// Reference encoder, ComposeCompactInstances gives the same bits. rotation is in degrees as in Transform,
+// colors are clamped to [0, 1].
+auto EncodeCompactInstance(float3 position, float3 rotation, float3 scale, float4 color) -> CompactInstance;
+
+// Reference decoder: expands compact instances to the model matrices and colors shaders read from
+// Instance, through ComposeInstances. Results differ from composing the original values only by
+// the quantization of the angles, scales and colors.
+void DecodeCompactInstances(const CompactInstance* instances, size_t count, Instance* out);
@@ -10,8 +10,13 @@
 #include "ComponentType.hpp"
 
 template<typename T>
-concept Component = requires (const T& a, const T& b) {
+concept Component = requires {
     { T::componentType } -> std::same_as<const ComponentType&>;
+};
+
+// Components that define an ordering can have their pool sorted on request (e.g. Mesh for draw batching).
+template<typename T>
+concept OrderedComponent = Component<T> && requires (const T& a, const T& b) {
     { a < b } -> std::same_as<bool>;
     { a > b } -> std::same_as<bool>;
     { a == b } -> std::same_as<bool>;
@@ -16,3 +16,17 @@ inline constexpr auto GetComponentMask(ComponentMask mask = {}) -> ComponentMask
     
     return mask;
 }
+
+// Group update filter. With Changed<A, B>, an update only visits members whose A or B changed
+// since the previous run of the same filtered update. Changed<> visits every member.
+template<Component... Args>
+struct Changed {
+    static auto Mask() -> ComponentMask {
+        if constexpr (sizeof...(Args) > 0) {
+            return GetComponentMask<Args...>();
+        }
+        else {
+            return {};
+        }
+    }
+};
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <span>
+#include <functional>
+#include <utility>
+#include <algorithm>
+
+#include "Entity.hpp"
+#include "ComponentMask.hpp"
+
+// Collects the entities that gained or lost each observed component type and hands them to
+// the registered callbacks in one batch per type when Notify is called.
+// Changes are netted per entity within a batch: an entity is delivered at most once per type and
+// direction, and a component that is added and removed again, or removed and added again, is not
+// delivered at all.
+// Batches reuse their storage, so once warmed up recording and delivery do not allocate.
+class ComponentObservers {
+public:
+    using Callback = std::function<void(std::span<const Entity>)>;
+    
+    void OnAdd(ComponentType type, Callback callback);
+    void OnRemove(ComponentType type, Callback callback);
+    
+    // Records the components of mask that have observers
+    void RecordAdd(Entity entity, ComponentMask mask);
+    void RecordAdd(std::span<const Entity> entities, ComponentMask mask);
+    void RecordRemove(Entity entity, ComponentMask mask);
+    
+    // Delivers the removals and then the additions recorded since the previous call.
+    // Additions are only delivered for entities that are alive and still have the component.
+    // Removals may name entities that were never delivered as added.
+    // Changes made by the callbacks are delivered on the next call.
+    template<typename SceneType>
+    void Notify(const SceneType& scene);
+private:
+    // Net change of one entity id in a batch
+    struct Change {
+        // First and last entity recorded with the id, they differ when the id was released and reused
+        Entity first;
+        Entity last;
+        // Whether first had the component before the batch and last has it after
+        bool firstHad;
+        bool lastHas;
+    };
+    
+    struct Batch {
+        std::vector<Change> changes;
+        // Indexed by entity id. An id's change index is only valid while its stamp is the batch's,
+        // so nothing is cleared per id between batches.
+        std::vector<uint32_t> stamps;
+        std::vector<uint32_t> changeIndices;
+        uint32_t stamp = 1;
+        
+        void Record(Entity entity, bool added);
+        void Clear();
+    };
+    
+    std::array<std::vector<Callback>, COMPONENT_COUNT> addCallbacks;
+    std::array<std::vector<Callback>, COMPONENT_COUNT> removeCallbacks;
+    // Types with add or remove observers. Both directions are recorded for them so pairs can cancel.
+    ComponentMask observed;
+    
+    std::array<Batch, COMPONENT_COUNT> pending;
+    // Swapped with pending while delivering so callbacks can record new changes
+    std::array<Batch, COMPONENT_COUNT> delivering;
+    
+    std::vector<Entity> delivered;
+    
+    void Record(std::span<const Entity> entities, ComponentMask mask, bool added);
+    
+    template<typename Select>
+    void Deliver(size_t type, std::vector<Callback>& callbacks, Select select);
+};
+
+inline void ComponentObservers::OnAdd(ComponentType type, Callback callback) {
+    addCallbacks[to_underlying(type)].push_back(std::move(callback));
+    observed.set(to_underlying(type));
+}
+
+inline void ComponentObservers::OnRemove(ComponentType type, Callback callback) {
+    removeCallbacks[to_underlying(type)].push_back(std::move(callback));
+    observed.set(to_underlying(type));
+}
+
+inline void ComponentObservers::RecordAdd(Entity entity, ComponentMask mask) {
+    Record({&entity, 1}, mask, true);
+}
+
+inline void ComponentObservers::RecordAdd(std::span<const Entity> entities, ComponentMask mask) {
+    Record(entities, mask, true);
+}
+
+inline void ComponentObservers::RecordRemove(Entity entity, ComponentMask mask) {
+    Record({&entity, 1}, mask, false);
+}
+
+template<typename SceneType>
+void ComponentObservers::Notify(const SceneType& scene) {
+    ComponentMask batches;
+    for (size_t i = 0; i < COMPONENT_COUNT; i++) {
+        if (!pending[i].changes.empty()) {
+            std::swap(pending[i], delivering[i]);
+            batches.set(i);
+        }
+    }
+    
+    for (size_t i = 0; i < COMPONENT_COUNT; i++) {
+        if (batches[i]) {
+            Deliver(i, removeCallbacks[i], [](const Change& change) -> const Entity* {
+                const bool removed = change.firstHad && (!change.lastHas || change.first != change.last);
+                return removed ? &change.first : nullptr;
+            });
+        }
+    }
+    
+    for (size_t i = 0; i < COMPONENT_COUNT; i++) {
+        if (batches[i]) {
+            Deliver(i, addCallbacks[i], [&scene, i](const Change& change) -> const Entity* {
+                const bool added = change.lastHas && (!change.firstHad || change.first != change.last);
+                return added && scene.IsAlive(change.last) && scene.GetMask(change.last)[i] ? &change.last : nullptr;
+            });
+            
+            delivering[i].Clear();
+        }
+    }
+}
+
+inline void ComponentObservers::Record(std::span<const Entity> entities, ComponentMask mask, bool added) {
+    mask &= observed;
+    
+    for (size_t i = 0; mask.any(); i++) {
+        if (mask[i]) {
+            for (auto entity : entities) {
+                pending[i].Record(entity, added);
+            }
+            mask.reset(i);
+        }
+    }
+}
+
+template<typename Select>
+void ComponentObservers::Deliver(size_t type, std::vector<Callback>& callbacks, Select select) {
+    if (callbacks.empty()) {
+        return;
+    }
+    
+    for (auto& change : delivering[type].changes) {
+        if (auto entity = select(change)) {
+            delivered.push_back(*entity);
+        }
+    }
+    
+    if (!delivered.empty()) {
+        for (auto& callback : callbacks) {
+            callback(delivered);
+        }
+    }
+    
+    delivered.clear();
+}
+
+inline void ComponentObservers::Batch::Record(Entity entity, bool added) {
+    if (entity.id >= stamps.size()) {
+        stamps.resize(entity.id + 1, 0);
+        changeIndices.resize(entity.id + 1);
+    }
+    
+    if (stamps[entity.id] != stamp) {
+        stamps[entity.id] = stamp;
+        changeIndices[entity.id] = static_cast<uint32_t>(changes.size());
+        changes.push_back({entity, entity, !added, added});
+        return;
+    }
+    
+    auto& change = changes[changeIndices[entity.id]];
+    change.last = entity;
+    change.lastHas = added;
+}
+
+inline void ComponentObservers::Batch::Clear() {
+    changes.clear();
+    
+    // Stamps from before a wrap around could match again
+    if (++stamp == 0) {
+        std::fill(stamps.begin(), stamps.end(), 0);
+        stamp = 1;
+    }
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <string_view>
 #include <unordered_map>
 
 template <typename Enum>
@@ -22,3 +23,20 @@ enum class ComponentType {
 
 inline constexpr size_t COMPONENT_COUNT = to_underlying(ComponentType::ComponentTypeCount);
 
+// No default case, so a type added without a name is a -Wswitch warning
+constexpr auto ComponentTypeName(ComponentType type) -> std::string_view {
+    switch (type) {
+        case ComponentType::transform: return "Transform";
+        case ComponentType::physics: return "Physics";
+        case ComponentType::camera: return "Camera";
+        case ComponentType::mesh: return "Mesh";
+        case ComponentType::hp: return "HP";
+        case ComponentType::enemy: return "Enemy";
+        case ComponentType::playerProjectile: return "PlayerProjectile";
+        case ComponentType::button: return "Button";
+        case ComponentType::anchor: return "Anchor";
+        case ComponentType::pickup: return "Pickup";
+        case ComponentType::ComponentTypeCount: break;
+    }
+    return {};
+}
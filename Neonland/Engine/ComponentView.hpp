@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <iterator>
+
+#include "Component.hpp"
+
+// Pool-like view over every component of one type in an ArchetypeScene.
+// The view is a snapshot and is invalidated by any structural change.
+template<Component T>
+class ComponentView {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = T*;
+        using reference = T&;
+        
+        iterator(typename std::vector<T*>::iterator it) : it{it} {}
+        
+        auto operator*() const -> T& { return **it; }
+        auto operator->() const -> T* { return *it; }
+        
+        auto operator++() -> iterator& {
+            ++it;
+            return *this;
+        }
+        
+        auto operator==(const iterator& rhs) const -> bool = default;
+    private:
+        typename std::vector<T*>::iterator it;
+    };
+    
+    auto operator[](size_t index) -> T& { return *components[index]; }
+    
+    auto begin() -> iterator { return iterator(components.begin()); }
+    auto end() -> iterator { return iterator(components.end()); }
+    
+    auto size() const -> size_t { return components.size(); }
+    
+    void Sort() requires OrderedComponent<T>;
+private:
+    std::vector<T*> components;
+    
+    friend class ArchetypeScene;
+};
+
+template<Component T>
+void ComponentView<T>::Sort() requires OrderedComponent<T> {
+    std::stable_sort(components.begin(), components.end(), [](auto a, auto b) {
+        return *a < *b;
+    });
+}
@@ -0,0 +1,85 @@
+#include "FrameAllocator.hpp"
+
+#include <new>
+#include <cstdint>
+#include <bit>
+#include <algorithm>
+
+namespace {
+    constexpr size_t minClassSize = 64;
+    constexpr size_t classCount = 7;
+    constexpr size_t maxClassSize = minClassSize << (classCount - 1);
+    
+    // Caps memory held by a thread that frees frames other threads allocated
+    constexpr uint32_t maxCachedPerClass = 32;
+    
+    struct FreeFrame {
+        FreeFrame* next;
+    };
+    
+    // Trivially destructible, so it stays usable after the releaser below has run
+    struct FreeLists {
+        FreeFrame* heads[classCount];
+        uint32_t counts[classCount];
+        bool released;
+    };
+    
+    thread_local FreeLists freeLists;
+    
+    struct FreeListsReleaser {
+        ~FreeListsReleaser() {
+            for (size_t i = 0; i < classCount; i++) {
+                while (auto frame = freeLists.heads[i]) {
+                    freeLists.heads[i] = frame->next;
+                    ::operator delete(frame);
+                }
+                freeLists.counts[i] = 0;
+            }
+            freeLists.released = true;
+        }
+    };
+    
+    thread_local FreeListsReleaser freeListsReleaser;
+    
+    auto SizeClass(size_t size) -> size_t {
+        return std::bit_width((std::max(size, minClassSize) - 1) / minClassSize);
+    }
+}
+
+auto FrameAllocator::Allocate(size_t size) -> void* {
+    if (size > maxClassSize) {
+        return ::operator new(size);
+    }
+    
+    const auto sizeClass = SizeClass(size);
+    
+    if (auto frame = freeLists.heads[sizeClass]) {
+        freeLists.heads[sizeClass] = frame->next;
+        freeLists.counts[sizeClass]--;
+        return frame;
+    }
+    
+    return ::operator new(minClassSize << sizeClass);
+}
+
+void FrameAllocator::Deallocate(void* ptr, size_t size) {
+    if (size > maxClassSize) {
+        ::operator delete(ptr);
+        return;
+    }
+    
+    const auto sizeClass = SizeClass(size);
+    
+    if (freeLists.released || freeLists.counts[sizeClass] >= maxCachedPerClass) {
+        ::operator delete(ptr);
+        return;
+    }
+    
+    // Touch the releaser so the thread's cache is freed when it exits
+    (void)&freeListsReleaser;
+    
+    auto frame = static_cast<FreeFrame*>(ptr);
+    frame->next = freeLists.heads[sizeClass];
+    freeLists.heads[sizeClass] = frame;
+    freeLists.counts[sizeClass]++;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstddef>
+
+// Allocator for coroutine frames. Freed frames are cached in per-thread free lists by size class,
+// so once warm, starting a task does not touch the heap. Frames above the largest class use the heap.
+class FrameAllocator final {
+public:
+    static auto Allocate(size_t size) -> void*;
+    
+    // size must be the size passed to Allocate
+    static void Deallocate(void* ptr, size_t size);
+};
@@ -13,6 +13,13 @@ typedef struct FrameData {
 
     size_t instanceCount;
     Instance* instances;
+    // Set instead of instances when the frame was composed in the compact format
+    CompactInstance* compactInstances;
+    
+    // Meshes left out because they were outside the view
+    size_t culledCount;
+    // Meshes left out because the destination was full
+    size_t droppedCount;
     
     uint32_t groupCount;
     
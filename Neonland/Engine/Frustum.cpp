@@ -0,0 +1,49 @@
+#include "Frustum.hpp"
+
+Frustum::Frustum(const float4x4& viewProjection) {
+    // The clip coordinates of the axes are the columns of the matrix, the planes are sums of its rows
+    const float4 x = viewProjection * float4{1, 0, 0, 0};
+    const float4 y = viewProjection * float4{0, 1, 0, 0};
+    const float4 z = viewProjection * float4{0, 0, 1, 0};
+    const float4 w = viewProjection * float4{0, 0, 0, 1};
+    
+    const float4 row0 = {x.x, y.x, z.x, w.x};
+    const float4 row1 = {x.y, y.y, z.y, w.y};
+    const float4 row2 = {x.z, y.z, z.z, w.z};
+    const float4 row3 = {x.w, y.w, z.w, w.w};
+    
+    planes = {
+        row3 + row0, row3 - row0,
+        row3 + row1, row3 - row1,
+        row2, row3 - row2,
+    };
+    
+    for (auto& plane : planes) {
+        plane /= std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+    }
+}
+
+auto Frustum::Intersects(float3 center, float radius) const -> bool {
+    for (const auto& plane : planes) {
+        if (Distance(plane, center) < -radius) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+auto Frustum::IntersectsSweep(float3 start, float3 end, float radius) const -> bool {
+    // Distances to a plane are linear along the way, so it is only outside one if both ends are
+    for (const auto& plane : planes) {
+        if (Distance(plane, start) < -radius && Distance(plane, end) < -radius) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+auto Frustum::Distance(const float4& plane, float3 point) const -> float {
+    return plane.x * point.x + plane.y * point.y + plane.z * point.z + plane.w;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <array>
+
+#include "MathUtils.hpp"
+
+// Planes bounding what a view-projection matrix shows, for clip space depth from 0 to w as in
+// both Metal and Direct3D. Tests are conservative: spheres near the corners may pass without
+// being visible, but no visible sphere fails.
+class Frustum final {
+public:
+    explicit Frustum(const float4x4& viewProjection);
+    
+    auto Intersects(float3 center, float radius) const -> bool;
+    
+    // Whether a sphere moving in a straight line from start to end can be visible anywhere on the way
+    auto IntersectsSweep(float3 start, float3 end, float radius) const -> bool;
+    
+    // xyz is the unit normal pointing inwards, w the signed distance of the origin
+    auto Planes() const -> const std::array<float4, 6>& { return planes; }
+private:
+    std::array<float4, 6> planes;
+    
+    auto Distance(const float4& plane, float3 point) const -> float;
+};
@@ -4,9 +4,12 @@
 #include <tuple>
 #include <vector>
 #include <concepts>
+#include <algorithm>
+#include <cassert>
 
 #include "IGroup.hpp"
 #include "Pool.hpp"
+#include "CommandBuffer.hpp"
 
 #include <future>
 #include <array>
@@ -19,32 +22,54 @@ class Group : public IGroup {
 public:
     Group<Args...>(ComponentMask exclude, std::shared_ptr<Pool<Args>>... pools);
     
-    template<typename Func> requires std::invocable<Func, Entity, Args&...>
-    void Update(Func func);
-    
-    template<typename Func> requires std::invocable<Func, Entity, Args&...>
-    void UpdateParallel(Func func);
-    
-    auto GetMembers() -> std::vector<std::tuple<Entity, Args&...>>;
+    // Filter is Changed<Ts...> to only visit members whose Ts changed since this filtered update last ran.
+    // The filtered components are treated as inputs and are not stamped as changed by the update,
+    // writes to them must be recorded with Scene::MarkChanged.
+    // Components in reads are only read by func and are not stamped either.
+    template<typename Filter = Changed<>, typename Func> requires std::invocable<Func, Entity, ComponentRef<Args>&...>
+    void Update(Func func, ComponentMask reads = {});
+    
+    // func is shared by the threads running the update
+    template<typename Filter = Changed<>, typename Func> requires std::invocable<Func, Entity, ComponentRef<Args>&...>
+    void UpdateParallel(Func func, ComponentMask reads = {});
+    
+    // Stamps every member's components as changed
+    auto GetMembers() -> std::vector<std::tuple<Entity, ComponentRef<Args>...>>;
+    
+    // Like GetMembers, but stamps nothing. Writes through the references must be recorded with Scene::MarkChanged.
+    auto ReadMembers() -> std::vector<std::tuple<Entity, ComponentRef<Args>...>>;
+    
+    // Batched passes over owning groups of SoA components. func gets the raw columns of Args, where
+    // index i belongs to GetEntities()[i]. UpdateColumnsParallel calls func(begin, end, columns...) for
+    // chunks of the members in parallel and stamps every member's components as changed.
+    template<typename Func> requires (SoAComponent<Args> && ...) && std::invocable<Func&, size_t, size_t, typename SoALayout<Args>::Columns&...>
+    void UpdateColumnsParallel(Func func);
+    
+    // Calls func(Size(), columns...) on the calling thread. Stamps nothing, so passes that only read
+    // can run alongside other readers.
+    template<typename Func> requires (SoAComponent<Args> && ...) && std::invocable<Func&, size_t, typename SoALayout<Args>::Columns&...>
+    void ReadColumns(Func func);
 private:
     std::tuple<std::shared_ptr<Pool<Args>>...> pools;
     
-    template<typename Func> requires std::invocable<Func, Entity, Args&...>
-    auto DoUpdates(Func func, std::shared_ptr<Pool<Args>>... pools);
+    template<typename Func> requires std::invocable<Func, Entity, ComponentRef<Args>&...>
+    auto DoUpdates(Func func, UpdateVersions versions, std::shared_ptr<Pool<Args>>... pools);
     
-    template<typename Func> requires std::invocable<Func, Entity, Args&...>
-    auto DoUpdatesParallel(Func func, std::shared_ptr<Pool<Args>>... pools);
-
-    auto GetMembers(std::shared_ptr<Pool<Args>>... pools) -> std::vector<std::tuple<Entity, Args&...>>;
+    template<typename Func> requires std::invocable<Func, Entity, ComponentRef<Args>&...>
+    auto DoUpdatesParallel(Func func, UpdateVersions versions, std::shared_ptr<Pool<Args>>... pools);
+    
+    // Calls func for the members in [begin, end) that pass the filter in versions
+    template<typename Func> requires std::invocable<Func, Entity, ComponentRef<Args>&...>
+    void UpdateRange(Func& func, size_t begin, size_t end, const UpdateVersions& versions, std::shared_ptr<Pool<Args>>&... pools);
+    
+    auto GetMembers(bool stamp, std::shared_ptr<Pool<Args>>... pools) -> std::vector<std::tuple<Entity, ComponentRef<Args>...>>;
     
     template<Component Type>
     auto GetPool() -> std::shared_ptr<Pool<Type>>;
     
-    template<Component Type, Component... Types>
-    auto LockPools(std::array<bool, sizeof...(Args)> lockStatesBeforeLock = {}) -> std::array<bool, sizeof...(Args)>;
-    
-    template<Component Type, Component... Types>
-    void UnlockPools(std::array<bool, sizeof...(Args)> lockStatesBeforeLock);
+    // Locks are counted, so updates of the same pools can overlap
+    void LockPools();
+    void UnlockPools();
 };
 
 template<Component... Args> requires (sizeof...(Args) > 0) && AllUnique<Args...>
@@ -53,84 +78,149 @@ Group<Args...>::Group(ComponentMask exclude, std::shared_ptr<Pool<Args>>... pool
 , pools{std::make_tuple(pools...)} { }
 
 template<Component... Args> requires (sizeof...(Args) > 0) && AllUnique<Args...>
-template<typename Func> requires std::invocable<Func, Entity, Args&...>
-void Group<Args...>::Update(Func func) {
-    DoUpdates(func, GetPool<Args>()...);
+template<typename Filter, typename Func> requires std::invocable<Func, Entity, ComponentRef<Args>&...>
+void Group<Args...>::Update(Func func, ComponentMask reads) {
+    auto versions = BeginUpdate(Filter::Mask());
+    versions.reads = reads;
+    DoUpdates(func, versions, GetPool<Args>()...);
 }
 
 template<Component... Args> requires (sizeof...(Args) > 0) && AllUnique<Args...>
-template<typename Func> requires std::invocable<Func, Entity, Args&...>
-void Group<Args...>::UpdateParallel(Func func) {
-    auto statesBeforeLock = LockPools<Args...>();
-    DoUpdatesParallel(func, GetPool<Args>()...);
-    UnlockPools<Args...>(statesBeforeLock);
+template<typename Filter, typename Func> requires std::invocable<Func, Entity, ComponentRef<Args>&...>
+void Group<Args...>::UpdateParallel(Func func, ComponentMask reads) {
+    auto versions = BeginUpdate(Filter::Mask());
+    versions.reads = reads;
+    
+    LockPools();
+    DoUpdatesParallel(func, versions, GetPool<Args>()...);
+    UnlockPools();
 }
 
 template<Component... Args> requires (sizeof...(Args) > 0) && AllUnique<Args...>
-auto Group<Args...>::GetMembers() -> std::vector<std::tuple<Entity, Args&...>> {
-    return GetMembers(GetPool<Args>()...);
+auto Group<Args...>::GetMembers() -> std::vector<std::tuple<Entity, ComponentRef<Args>...>> {
+    return GetMembers(true, GetPool<Args>()...);
 }
 
 template<Component... Args> requires (sizeof...(Args) > 0) && AllUnique<Args...>
-template<typename Func> requires std::invocable<Func, Entity, Args&...>
-auto Group<Args...>::DoUpdates(Func func, std::shared_ptr<Pool<Args>>... pools) {
-    auto entities = groupEntities;
-    
-    for (auto entity : entities) {
-        func(entity, pools->GetComponent(entity.id)...);
-    }
+auto Group<Args...>::ReadMembers() -> std::vector<std::tuple<Entity, ComponentRef<Args>...>> {
+    return GetMembers(false, GetPool<Args>()...);
 }
 
 template<Component... Args> requires (sizeof...(Args) > 0) && AllUnique<Args...>
-template<typename Func> requires std::invocable<Func, Entity, Args&...>
-auto Group<Args...>::DoUpdatesParallel(Func func, std::shared_ptr<Pool<Args>>... pools) {
-    auto entities = groupEntities;
-    
-    if (entities.empty()) {
-        return;
-    }
-    
-    const size_t entityCount = entities.size();
-    const auto jobCount = entityCount < ThreadPool::ThreadCount ? entityCount : ThreadPool::ThreadCount;
-    const auto entitiesPerJob = entityCount / jobCount;
+template<typename Func> requires (SoAComponent<Args> && ...) && std::invocable<Func&, size_t, size_t, typename SoALayout<Args>::Columns&...>
+void Group<Args...>::UpdateColumnsParallel(Func func) {
+    assert(IsOwning() && "Column passes need an owning group");
     
-    using iterator = std::vector<Entity>::iterator;
-    
-    auto UpdateEntitiesInRange = [func, &pools...] (iterator begin, iterator end) {
-        for (auto it = begin; it != end; ++it) {
-            auto entity = *it;
-            func(entity, pools->GetComponent(entity.id)...);
-        }
-    };
+    // Chunks are cheap to run, so they are larger than in DoUpdatesParallel
+    constexpr size_t minEntitiesPerJob = 256;
     
+    const auto stamp = BeginUpdate({}).stamp;
+    const std::array<Version*, sizeof...(Args)> poolVersions = { GetVersions(*GetPool<Args>())... };
+    const auto columns = std::tie(GetPool<Args>()->GetColumns()...);
     
-    std::vector<std::future<void>> jobs;
-    jobs.reserve(jobCount);
+    const size_t set = commandBufferSet;
     
-    auto& threadPool = ThreadPool::GetInstance();
+    LockPools();
     
-    auto entityIt = entities.begin();
-    for (int i = 0; i < jobCount - 1; i++) {
-        std::function<void()> task = std::bind(UpdateEntitiesInRange, entityIt, entityIt + entitiesPerJob);
-        jobs.push_back(threadPool.SubmitJob(task));
-        entityIt += entitiesPerJob;
-    }
+    ThreadPool::GetInstance().ParallelFor(0, groupEntities.size(), minEntitiesPerJob, [&](size_t jobIdx, size_t begin, size_t end) {
+        for (auto versions : poolVersions) {
+            std::fill(versions + begin, versions + end, stamp);
+        }
+        
+        CommandBufferScope scope{set, jobIdx};
+        std::apply([&](auto&... poolColumns) { func(begin, end, poolColumns...); }, columns);
+    });
     
-    UpdateEntitiesInRange(entityIt, entities.end());
+    UnlockPools();
+}
+
+template<Component... Args> requires (sizeof...(Args) > 0) && AllUnique<Args...>
+template<typename Func> requires (SoAComponent<Args> && ...) && std::invocable<Func&, size_t, typename SoALayout<Args>::Columns&...>
+void Group<Args...>::ReadColumns(Func func) {
+    assert(IsOwning() && "Column passes need an owning group");
+    func(groupEntities.size(), GetPool<Args>()->GetColumns()...);
+}
+
+template<Component... Args> requires (sizeof...(Args) > 0) && AllUnique<Args...>
+template<typename Func> requires std::invocable<Func, Entity, ComponentRef<Args>&...>
+auto Group<Args...>::DoUpdates(Func func, UpdateVersions versions, std::shared_ptr<Pool<Args>>... pools) {
+    // Structural changes are deferred to command buffers, so the members can be iterated in place
+    UpdateRange(func, 0, groupEntities.size(), versions, pools...);
+}
+
+template<Component... Args> requires (sizeof...(Args) > 0) && AllUnique<Args...>
+template<typename Func> requires std::invocable<Func, Entity, ComponentRef<Args>&...>
+auto Group<Args...>::DoUpdatesParallel(Func func, UpdateVersions versions, std::shared_ptr<Pool<Args>>... pools) {
+    // Smaller groups are updated on the calling thread
+    constexpr size_t minEntitiesPerJob = 32;
+    
+    // Chunk i records its structural changes into command buffer i of the calling system's set
+    const size_t set = commandBufferSet;
+    
+    ThreadPool::GetInstance().ParallelFor(0, groupEntities.size(), minEntitiesPerJob, [&](size_t jobIdx, size_t begin, size_t end) {
+        CommandBufferScope scope{set, jobIdx};
+        UpdateRange(func, begin, end, versions, pools...);
+    });
+}
+
+template<Component... Args> requires (sizeof...(Args) > 0) && AllUnique<Args...>
+template<typename Func> requires std::invocable<Func, Entity, ComponentRef<Args>&...>
+void Group<Args...>::UpdateRange(Func& func, size_t begin, size_t end, const UpdateVersions& versions, std::shared_ptr<Pool<Args>>&... pools) {
+    constexpr auto poolCount = sizeof...(Args);
+    
+    const bool filtered = versions.filter.any();
+    const std::array<bool, poolCount> isInput = { versions.filter[to_underlying(Args::componentType)]... };
+    const std::array<bool, poolCount> isRead = { versions.reads[to_underlying(Args::componentType)]... };
+    const std::array<Version*, poolCount> poolVersions = { GetVersions(*pools)... };
+    
+    // Components are passed as lvalues, which SoA refs are not when returned from the pool
+    auto Call = [&]<size_t... I>(Entity entity, const std::array<Index, poolCount>& indices, std::index_sequence<I...>) {
+        std::tuple<ComponentRef<Args>...> components{ (*pools)[indices[I]]... };
+        std::apply([&](auto&... components) { func(entity, components...); }, components);
+    };
     
-    for (auto& job : jobs) {
-        job.wait();
+    for (size_t i = begin; i < end; i++) {
+        auto entity = groupEntities[i];
+        
+        // Members are packed at the front of owned pools, so no index lookup is needed
+        const std::array<Index, poolCount> indices = { (IsOwning() ? static_cast<Index>(i) : IndexOf(*pools, entity.id))... };
+        
+        if (filtered && joinVersions[i] < versions.since) {
+            bool changed = false;
+            for (size_t p = 0; p < poolCount; p++) {
+                changed |= isInput[p] && poolVersions[p][indices[p]] >= versions.since;
+            }
+            
+            if (!changed) {
+                continue;
+            }
+        }
+        
+        for (size_t p = 0; p < poolCount; p++) {
+            if (!isInput[p] && !isRead[p]) {
+                poolVersions[p][indices[p]] = versions.stamp;
+            }
+        }
+        
+        Call(entity, indices, std::index_sequence_for<Args...>{});
     }
 }
 
 template<Component... Args> requires (sizeof...(Args) > 0) && AllUnique<Args...>
-auto Group<Args...>::GetMembers(std::shared_ptr<Pool<Args>>... pools) -> std::vector<std::tuple<Entity, Args&...>> {
-    std::vector<std::tuple<Entity, Args&...>> members;
+auto Group<Args...>::GetMembers(bool stamp, std::shared_ptr<Pool<Args>>... pools) -> std::vector<std::tuple<Entity, ComponentRef<Args>...>> {
+    std::vector<std::tuple<Entity, ComponentRef<Args>...>> members;
     members.reserve(groupEntities.size());
     
+    if (stamp) {
+        const auto version = BeginUpdate({}).stamp;
+        
+        for (auto entity : groupEntities) {
+            ((GetVersions(*pools)[IndexOf(*pools, entity.id)] = version), ...);
+        }
+    }
+    
     for (auto entity : groupEntities) {
-        auto member = std::forward_as_tuple(entity, pools->GetComponent(entity.id)...);
-        members.push_back(member);
+        members.emplace_back(entity, pools->GetComponent(entity.id)...);
     }
     
     return members;
@@ -143,34 +233,11 @@ auto Group<Args...>::GetPool() -> std::shared_ptr<Pool<Type>> {
 }
 
 template<Component... Args> requires (sizeof...(Args) > 0) && AllUnique<Args...>
-template<Component Type, Component... Types>
-auto Group<Args...>::LockPools(std::array<bool, sizeof...(Args)> lockStatesBeforeLock) -> std::array<bool, sizeof...(Args)> {
-    auto poolPtr = GetPool<Type>();
-    lockStatesBeforeLock[sizeof...(Args) - sizeof...(Types) - 1] = IsRemoveLocked(*poolPtr);
-    
-    if (!IsRemoveLocked(*poolPtr)) {
-        LockRemove(*poolPtr);
-    }
-    
-    if constexpr (sizeof...(Types) > 0) {
-        return LockPools<Types...>(lockStatesBeforeLock);
-    }
-    
-    return lockStatesBeforeLock;
+void Group<Args...>::LockPools() {
+    (LockRemove(*GetPool<Args>()), ...);
 }
 
 template<Component... Args> requires (sizeof...(Args) > 0) && AllUnique<Args...>
-template<Component Type, Component... Types>
-void Group<Args...>::UnlockPools(std::array<bool, sizeof...(Args)> lockStatesBeforeLock) {
-    bool wasAlreadyLocked = lockStatesBeforeLock[sizeof...(Args) - sizeof...(Types) - 1];
-    
-    auto poolPtr = GetPool<Type>();
-    
-    if (!wasAlreadyLocked && IsRemoveLocked(*poolPtr)) {
-        UnlockRemove(*poolPtr);
-    }
-    
-    if constexpr (sizeof...(Types) > 0) {
-        UnlockPools<Types...>(lockStatesBeforeLock);
-    }
+void Group<Args...>::UnlockPools() {
+    (UnlockRemove(*GetPool<Args>()), ...);
 }
@@ -1,10 +1,11 @@
 #include "IGroup.hpp"
 
-#include <numeric>
+#include <cassert>
 
 IGroup::IGroup(ComponentMask require, ComponentMask exclude)
 : requireMask{require}
-, excludeMask{exclude & ~requireMask} { }
+, excludeMask{exclude & ~requireMask}
+, sceneVersion{nullptr} { }
 
 IGroup::~IGroup() { }
 
@@ -12,66 +13,100 @@ auto IGroup::Size() -> size_t {
     return groupEntities.size();
 }
 
-void IGroup::AddEntity(Entity entity) {
-    auto upperBound = std::upper_bound(groupEntities.begin(), groupEntities.end(), entity, [](auto a, auto b) {
-        return a.id < b.id;
-    });
-    groupEntities.insert(upperBound, entity);
+auto IGroup::Contains(Entity::Id entityId) const -> bool {
+    return entityId < entityIdToIndex.size() && entityIdToIndex[entityId] != NOT_MEMBER;
 }
 
-void IGroup::AddEntities(const std::vector<Entity>& sortedEntities) {
-    size_t beginIndex = 0;
-    for (size_t i = 1; i < sortedEntities.size(); i++) {
-        if (sortedEntities[i - 1].id != sortedEntities[i].id - 1) {
-            auto upperBound = std::upper_bound(groupEntities.begin(), groupEntities.end(), sortedEntities[beginIndex], [](auto a, auto b) {
-                return a.id < b.id;
-            });
-            
-            groupEntities.insert(upperBound, sortedEntities.begin() + beginIndex, sortedEntities.begin() + i);
-            beginIndex = i;
-        }
+auto IGroup::IsOwning() const -> bool {
+    return !ownedPools.empty();
+}
+
+void IGroup::AddEntity(Entity entity) {
+    assert(!Contains(entity.id) && "Entity cannot be added to a group twice");
+    
+    if (entity.id + 1 > entityIdToIndex.size()) {
+        entityIdToIndex.resize(entity.id + 1, NOT_MEMBER);
     }
     
-    auto upperBound = std::upper_bound(groupEntities.begin(), groupEntities.end(), sortedEntities[beginIndex], [](auto a, auto b) {
-        return a.id < b.id;
-    });
+    auto index = static_cast<Index>(groupEntities.size());
+    
+    for (auto pool : ownedPools) {
+        pool->SwapIndices(pool->entityIdToIndex[entity.id], index);
+    }
     
-    groupEntities.insert(upperBound, sortedEntities.begin() + beginIndex, sortedEntities.end());
+    entityIdToIndex[entity.id] = index;
+    groupEntities.push_back(entity);
+    joinVersions.push_back(*sceneVersion);
 }
 
-void IGroup::RemoveEntity(Entity::Id entityId) {
-    auto lowerBound = std::lower_bound(groupEntities.begin(), groupEntities.end(), entityId, [](auto entity, auto id) {
-        return entity.id < id;
-    });
-    groupEntities.erase(lowerBound);
+void IGroup::AddEntities(const std::vector<Entity>& entities) {
+    groupEntities.reserve(groupEntities.size() + entities.size());
+    joinVersions.reserve(joinVersions.size() + entities.size());
+    
+    for (auto entity : entities) {
+        AddEntity(entity);
+    }
 }
 
-void IGroup::RemoveEntities(const std::vector<Entity>& sortedEntities) {
-    size_t beginIndex = 0;
-    for (size_t i = 1; i < sortedEntities.size(); i++) {
-        if (sortedEntities[i - 1].id != sortedEntities[i].id - 1) {
-            auto lowerBound = std::lower_bound(groupEntities.begin(), groupEntities.end(), sortedEntities[beginIndex], [](auto a, auto b) {
-                return a.id < b.id;
-            });
-            
-            groupEntities.erase(lowerBound, lowerBound + (i - beginIndex));
-            beginIndex = i;
-        }
+void IGroup::RemoveEntity(Entity::Id entityId) {
+    assert(Contains(entityId) && "Entity must be a member of the group");
+    
+    Index index = entityIdToIndex[entityId];
+    Entity last = groupEntities.back();
+    
+    // Owned pools mirror the swap so the members stay packed at the front
+    for (auto pool : ownedPools) {
+        pool->SwapIndices(index, static_cast<Index>(groupEntities.size() - 1));
     }
     
-    auto lowerBound = std::lower_bound(groupEntities.begin(), groupEntities.end(), sortedEntities[beginIndex], [](auto a, auto b) {
-        return a.id < b.id;
-    });
+    groupEntities[index] = last;
+    entityIdToIndex[last.id] = index;
+    joinVersions[index] = joinVersions.back();
     
-    groupEntities.erase(lowerBound, lowerBound + (sortedEntities.size() - beginIndex));
+    groupEntities.pop_back();
+    joinVersions.pop_back();
+    entityIdToIndex[entityId] = NOT_MEMBER;
+}
+
+void IGroup::RemoveEntities(const std::vector<Entity>& entities) {
+    for (auto entity : entities) {
+        RemoveEntity(entity.id);
+    }
 }
 
 auto IGroup::GetEntities() const -> const std::vector<Entity>& {
     return groupEntities;
 }
 
-auto IGroup::IsRemoveLocked(const IPool& pool) const -> bool {
-    return pool.IsRemoveLocked();
+auto IGroup::BeginUpdate(ComponentMask filter) -> UpdateVersions {
+    assert((filter & ~requireMask).none() && "Filtered components must be part of the group");
+    
+    const auto stamp = ++*sceneVersion;
+    
+    if (filter.none()) {
+        return {filter, 0, stamp, {}};
+    }
+    
+    std::unique_lock lock(filterVersionsMutex);
+    
+    for (auto& [mask, version] : filterVersions) {
+        if (mask == filter) {
+            auto since = version;
+            version = stamp;
+            return {filter, since, stamp, {}};
+        }
+    }
+    
+    filterVersions.push_back({filter, stamp});
+    return {filter, 0, stamp, {}};
+}
+
+auto IGroup::GetVersions(IPool& pool) -> Version* {
+    return pool.versions.data();
+}
+
+auto IGroup::IndexOf(const IPool& pool, Entity::Id entityId) -> Index {
+    return pool.entityIdToIndex[entityId];
 }
 
 void IGroup::LockRemove(IPool& pool) {
@@ -3,6 +3,8 @@
 #include <vector>
 #include <array>
 #include <memory>
+#include <utility>
+#include <mutex>
 
 #include "IPool.hpp"
 #include "ComponentMask.hpp"
@@ -21,17 +23,61 @@ public:
     
     auto GetEntities() const -> const std::vector<Entity>&;
     auto Size() -> size_t;
+    
+    auto Contains(Entity::Id entityId) const -> bool;
+    
+    auto IsOwning() const -> bool;
 protected:
+    using Index = Entity::Id;
+    static constexpr Index NOT_MEMBER = Entity::NULL_ID;
+    
+    // Membership is a sparse set: groupEntities is packed for iteration and
+    // entityIdToIndex gives the position of each member, so adding and removing are O(1).
+    // Members are not kept in any particular order.
     std::vector<Entity> groupEntities;
-    auto IsRemoveLocked(const IPool& pool) const -> bool;
+    std::vector<Index> entityIdToIndex;
+    
+    // An owning group keeps the components of its members in the first Size() slots
+    // of each owned pool, in the same order as groupEntities
+    std::vector<IPool*> ownedPools;
+    
+    using Version = IPool::Version;
+    
+    // Scene-wide change counter. Each update takes a new version and stamps the
+    // components it hands out, except the ones its Changed filter reads.
+    // Atomic because systems scheduled concurrently update groups at the same time.
+    std::atomic<Version>* sceneVersion;
+    
+    // Version at which each member joined, in groupEntities order. New members count as changed.
+    std::vector<Version> joinVersions;
+    
+    // Version of the previous run of each filtered update. Locked because filtered updates of
+    // systems scheduled concurrently can begin at the same time.
+    std::vector<std::pair<ComponentMask, Version>> filterVersions;
+    std::mutex filterVersionsMutex;
+    
+    struct UpdateVersions {
+        ComponentMask filter;
+        // Members whose filtered components changed at or after since are visited
+        Version since;
+        Version stamp;
+        // Components the update only reads. Like the filtered ones, they are not stamped.
+        ComponentMask reads;
+    };
+    
+    auto BeginUpdate(ComponentMask filter) -> UpdateVersions;
+    
+    static auto GetVersions(IPool& pool) -> Version*;
+    static auto IndexOf(const IPool& pool, Entity::Id entityId) -> Index;
+    
     void LockRemove(IPool& pool);
     void UnlockRemove(IPool& pool);
 private:
     void AddEntity(Entity entity);
-    void AddEntities(const std::vector<Entity>& sortedEntities);
+    void AddEntities(const std::vector<Entity>& entities);
     
     void RemoveEntity(Entity::Id entityId);
-    void RemoveEntities(const std::vector<Entity>& sortedEntities);
+    void RemoveEntities(const std::vector<Entity>& entities);
     
     friend class Scene;
 };
@@ -1,8 +1,12 @@
 #include "IPool.hpp"
 
+#include <cassert>
+
 IPool::IPool(ComponentType type)
-: componentType{type}
-, removeLocked{false} {}
+: sceneVersion{nullptr}
+, removeLocks{0}
+, componentType{type}
+, owner{nullptr} {}
 
 IPool::~IPool() { }
 
@@ -14,17 +18,23 @@ auto IPool::HasComponentFor(const Entity::Id entityId) const -> bool {
     return entityId < entityIdToIndex.size() && entityIdToIndex[entityId] != DESTROYED;
 }
 
+void IPool::MarkChanged(Entity::Id entityId) {
+    versions[entityIdToIndex[entityId]] = *sceneVersion;
+}
+
 auto IPool::IsRemoveLocked() const -> bool {
-    return removeLocked;
+    return removeLocks.load(std::memory_order_acquire) > 0;
 }
 
 void IPool::LockRemove() {
-    removeLocked = true;
+    removeLocks.fetch_add(1, std::memory_order_acq_rel);
 }
 
 void IPool::UnlockRemove() {
-    removeLocked = false;
-    if (!removeLockedCache.empty()) {
+    assert(IsRemoveLocked() && "Pool must be locked");
+    
+    // Removals only happen in Exclusive systems, so nothing else runs while the cache is played back
+    if (removeLocks.fetch_sub(1, std::memory_order_acq_rel) == 1 && !removeLockedCache.empty()) {
         for (auto entityId : removeLockedCache) {
             RemoveComponent(entityId);
         }
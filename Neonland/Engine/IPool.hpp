@@ -5,12 +5,18 @@
 #include <limits>
 #include <string_view>
 #include <string>
+#include <atomic>
 
 #include "Entity.hpp"
 #include "ComponentType.hpp"
 
+class IGroup;
+
 class IPool {
 public:
+    // Scene-wide counter value recorded when a component is added or mutably accessed
+    using Version = uint64_t;
+    
     virtual ~IPool();
     auto size() const -> size_t;
 protected:
@@ -20,17 +26,31 @@ protected:
     std::vector<Index> entityIdToIndex;
     std::vector<Entity::Id> indexToEntityId;
     
-    bool removeLocked;
+    // Change version of each component, in component order
+    std::vector<Version> versions;
+    const std::atomic<Version>* sceneVersion;
+    
+    // Number of updates iterating the pool. Counted because systems scheduled concurrently can
+    // iterate the same pool, removals are deferred until the last one unlocks.
+    std::atomic<uint32_t> removeLocks;
     std::vector<Entity::Id> removeLockedCache;
     
     const ComponentType componentType;
     
+    // Owning group that keeps its members in the first slots of this pool, if any
+    IGroup* owner;
+    
     IPool(ComponentType type);
     
     auto HasComponentFor(Entity::Id entityId) const -> bool;
     
+    void MarkChanged(Entity::Id entityId);
+    
     virtual void RemoveComponent(Entity::Id entityId) = 0;
     
+    // Swaps the components at two indices, keeping the index mappings in sync
+    virtual void SwapIndices(Index a, Index b) = 0;
+    
     auto IsRemoveLocked() const -> bool;
     void LockRemove();
     void UnlockRemove();
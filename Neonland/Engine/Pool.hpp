@@ -1,9 +1,12 @@
 #pragma once
 
 #include <memory>
+#include <numeric>
+#include <algorithm>
 
 #include "IPool.hpp"
 #include "Component.hpp"
+#include "SoA.hpp"
 #include <mutex>
 
 #include <iostream>
@@ -31,13 +34,19 @@ public:
     
     auto GetComponent(Entity::Id entityId) -> T&;
     
-    void Sort();
+    // Components are stored densely in insertion order. Pools of ordered components
+    // can be sorted explicitly, e.g. to batch draw calls.
+    void Sort() requires OrderedComponent<T>;
 private:
     std::vector<T> components;
     
     void RemoveComponent(Entity::Id entityId) override final;
+    void SwapIndices(Index a, Index b) override final;
     void AddComponent(Entity::Id entityId, T&& component);
     
+    // Makes room for count more components
+    void Reserve(size_t count);
+    
     friend class Scene;
 };
 
@@ -103,47 +112,203 @@ void Pool<T>::AddComponent(const Entity::Id entityId, T&& component) {
         entityIdToIndex.resize(entityId + 1, DESTROYED);
     }
     
-    Index index = static_cast<Index>(std::upper_bound(components.begin(), components.end(), component) - components.begin());
-    entityIdToIndex[entityId] = index;
-    for (Index i = index; i < indexToEntityId.size(); i++) {
-        entityIdToIndex[indexToEntityId[i]]++;
-    }
-    indexToEntityId.insert(indexToEntityId.begin() + index, entityId);
-    components.insert(components.begin() + index, component);
+    entityIdToIndex[entityId] = static_cast<Index>(components.size());
+    indexToEntityId.push_back(entityId);
+    versions.push_back(*sceneVersion);
+    components.push_back(std::move(component));
+}
+
+template<Component T>
+void Pool<T>::Reserve(size_t count) {
+    components.reserve(components.size() + count);
+    indexToEntityId.reserve(indexToEntityId.size() + count);
+    versions.reserve(versions.size() + count);
 }
 
 template<Component T>
 void Pool<T>::RemoveComponent(Entity::Id entityId) {
     assert(HasComponentFor(entityId) && "Entity must have the specified component");
     
-    if (removeLocked) {
+    if (IsRemoveLocked()) {
         removeLockedCache.push_back(entityId);
     }
     else {
         Index index = entityIdToIndex[entityId];
-        components.erase(components.begin() + index);
-        indexToEntityId.erase(indexToEntityId.begin() + index);
-        for (Index i = index; i < indexToEntityId.size(); i++) {
-            entityIdToIndex[indexToEntityId[i]]--;
+        Index lastIndex = static_cast<Index>(components.size() - 1);
+        
+        if (index != lastIndex) {
+            Entity::Id lastEntityId = indexToEntityId[lastIndex];
+            components[index] = std::move(components[lastIndex]);
+            indexToEntityId[index] = lastEntityId;
+            versions[index] = versions[lastIndex];
+            entityIdToIndex[lastEntityId] = index;
         }
+        
+        components.pop_back();
+        indexToEntityId.pop_back();
+        versions.pop_back();
         entityIdToIndex[entityId] = DESTROYED;
     }
 }
 
+template<Component T>
+void Pool<T>::SwapIndices(Index a, Index b) {
+    if (a == b) {
+        return;
+    }
+    
+    std::swap(components[a], components[b]);
+    std::swap(indexToEntityId[a], indexToEntityId[b]);
+    std::swap(versions[a], versions[b]);
+    entityIdToIndex[indexToEntityId[a]] = a;
+    entityIdToIndex[indexToEntityId[b]] = b;
+}
+
 template<Component T>
 auto Pool<T>::GetComponent(Entity::Id entityId) -> T& {
     return components[entityIdToIndex[entityId]];
 }
 
 template<Component T>
-void Pool<T>::Sort() {
-    std::sort(indexToEntityId.begin(), indexToEntityId.end(), [this](auto a, auto b) {
-        return components[entityIdToIndex[a]] < components[entityIdToIndex[b]];
+void Pool<T>::Sort() requires OrderedComponent<T> {
+    assert(owner == nullptr && "Pool owned by a group cannot be sorted");
+    
+    if (std::is_sorted(components.begin(), components.end())) {
+        return;
+    }
+    
+    std::vector<Index> order(components.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [this](auto a, auto b) {
+        return components[a] < components[b];
     });
     
-    std::sort(components.begin(), components.end());
+    std::vector<T> sortedComponents;
+    sortedComponents.reserve(components.size());
+    std::vector<Entity::Id> sortedEntityIds;
+    sortedEntityIds.reserve(indexToEntityId.size());
+    std::vector<Version> sortedVersions;
+    sortedVersions.reserve(versions.size());
+    
+    for (auto index : order) {
+        sortedComponents.push_back(std::move(components[index]));
+        sortedEntityIds.push_back(indexToEntityId[index]);
+        sortedVersions.push_back(versions[index]);
+    }
+    
+    components = std::move(sortedComponents);
+    indexToEntityId = std::move(sortedEntityIds);
+    versions = std::move(sortedVersions);
     
     for (Index idx = 0; idx < indexToEntityId.size(); idx++) {
         entityIdToIndex[indexToEntityId[idx]] = idx;
     }
 }
+
+// Pool of a component stored as structure of arrays. Every field listed in SoALayout<T>::Columns
+// gets its own array, so passes only stream the fields they touch. Components are accessed
+// through SoALayout<T>::Ref, which refers to the fields of one element.
+template<SoAComponent T>
+class Pool<T> : public IPool {
+public:
+    using Columns = typename SoALayout<T>::Columns;
+    using Ref = typename SoALayout<T>::Ref;
+    
+    Pool<T>();
+    
+    auto operator[](size_t index) -> Ref;
+    
+    auto GetComponent(Entity::Id entityId) -> Ref;
+    
+    // Raw field arrays, indexed like operator[]
+    auto GetColumns() -> Columns&;
+private:
+    Columns columns;
+    
+    void RemoveComponent(Entity::Id entityId) override final;
+    void SwapIndices(Index a, Index b) override final;
+    void AddComponent(Entity::Id entityId, T&& component);
+    
+    void Reserve(size_t count);
+    
+    friend class Scene;
+};
+
+template<SoAComponent T>
+Pool<T>::Pool()
+: IPool(T::componentType) {}
+
+template<SoAComponent T>
+auto Pool<T>::operator[](size_t index) -> Ref {
+    return Ref(columns, index);
+}
+
+template<SoAComponent T>
+auto Pool<T>::GetComponent(Entity::Id entityId) -> Ref {
+    return Ref(columns, entityIdToIndex[entityId]);
+}
+
+template<SoAComponent T>
+auto Pool<T>::GetColumns() -> Columns& {
+    return columns;
+}
+
+template<SoAComponent T>
+void Pool<T>::AddComponent(const Entity::Id entityId, T&& component) {
+    assert(!(entityId < entityIdToIndex.size() && entityIdToIndex[entityId] != DESTROYED) && "Component cannot be added twice");
+    
+    if (entityId + 1 > entityIdToIndex.size()) {
+        entityIdToIndex.resize(entityId + 1, DESTROYED);
+    }
+    
+    entityIdToIndex[entityId] = static_cast<Index>(indexToEntityId.size());
+    indexToEntityId.push_back(entityId);
+    versions.push_back(*sceneVersion);
+    columns.PushBack(component);
+}
+
+template<SoAComponent T>
+void Pool<T>::Reserve(size_t count) {
+    columns.Reserve(indexToEntityId.size() + count);
+    indexToEntityId.reserve(indexToEntityId.size() + count);
+    versions.reserve(versions.size() + count);
+}
+
+template<SoAComponent T>
+void Pool<T>::RemoveComponent(Entity::Id entityId) {
+    assert(HasComponentFor(entityId) && "Entity must have the specified component");
+    
+    if (IsRemoveLocked()) {
+        removeLockedCache.push_back(entityId);
+    }
+    else {
+        Index index = entityIdToIndex[entityId];
+        Index lastIndex = static_cast<Index>(indexToEntityId.size() - 1);
+        
+        if (index != lastIndex) {
+            Entity::Id lastEntityId = indexToEntityId[lastIndex];
+            columns.Move(index, lastIndex);
+            indexToEntityId[index] = lastEntityId;
+            versions[index] = versions[lastIndex];
+            entityIdToIndex[lastEntityId] = index;
+        }
+        
+        columns.PopBack();
+        indexToEntityId.pop_back();
+        versions.pop_back();
+        entityIdToIndex[entityId] = DESTROYED;
+    }
+}
+
+template<SoAComponent T>
+void Pool<T>::SwapIndices(Index a, Index b) {
+    if (a == b) {
+        return;
+    }
+    
+    columns.Swap(a, b);
+    std::swap(indexToEntityId[a], indexToEntityId[b]);
+    std::swap(versions[a], versions[b]);
+    entityIdToIndex[indexToEntityId[a]] = a;
+    entityIdToIndex[indexToEntityId[b]] = b;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <tuple>
+#include <utility>
+
+#include "Component.hpp"
+
+// Template components copied into every entity created with Scene::Instantiate
+template<Component... Args> requires (sizeof...(Args) > 0 && AllUnique<Args...>)
+class Prefab {
+public:
+    std::tuple<Args...> components;
+    
+    Prefab(Args... components)
+    : components{std::move(components)...} { }
+    
+    template<Component T>
+    auto Get() -> T& {
+        return std::get<T>(components);
+    }
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <bitset>
+#include <concepts>
+#include <string_view>
+
+#include "ComponentType.hpp"
+
+// State outside the components that systems share, like the audio queue. A resource is an empty
+// marker type naming the state so systems can declare their accesses to it like to components.
+enum class ResourceType {
+    audio,
+    gameState,
+    powerUps,
+    ResourceTypeCount,
+};
+
+inline constexpr size_t RESOURCE_COUNT = to_underlying(ResourceType::ResourceTypeCount);
+
+// No default case, so a type added without a name is a -Wswitch warning
+constexpr auto ResourceTypeName(ResourceType type) -> std::string_view {
+    switch (type) {
+        case ResourceType::audio: return "Audio";
+        case ResourceType::gameState: return "GameState";
+        case ResourceType::powerUps: return "PowerUps";
+        case ResourceType::ResourceTypeCount: break;
+    }
+    return {};
+}
+
+template<typename T>
+concept Resource = requires {
+    { T::resourceType } -> std::same_as<const ResourceType&>;
+};
+
+using ResourceMask = std::bitset<RESOURCE_COUNT>;
@@ -3,12 +3,16 @@
 Scene::Scene()
 : nextEntityId{0}
 , releasedEntityCount{0}
-, pools(COMPONENT_COUNT, nullptr) {}
+, commandBuffers(ThreadPool::ThreadCount() + 1)
+, pools(COMPONENT_COUNT, nullptr)
+, changeVersion{0} {}
 
 void Scene::DestroyEntity(Entity entity) {
-    std::scoped_lock lock{destroyMutex};
     auto mask = entityIdToMask[entity.id];
     
+    // Groups are updated first so owning groups can move the components out of their packed range
+    UpdateGroups(entity, {});
+    
     size_t n = 0;
     for (size_t i = 0; n < mask.count(); i++) {
         if (mask[i]) {
@@ -17,11 +21,42 @@ void Scene::DestroyEntity(Entity entity) {
         }
     }
     
-    UpdateGroups(entity, {});
     ReleaseEntity(entity);
 }
 
-auto Scene::Has(Entity entity, ComponentType type) -> bool {
+auto Scene::Commands() -> CommandBuffer<Scene>& {
+    const size_t jobCount = ThreadPool::ThreadCount() + 1;
+    
+    assert(commandBufferIndex < jobCount && "Command buffer index must be less than the job count");
+    assert((commandBufferSet + 1) * jobCount <= commandBuffers.size() && "Scheduled systems must have reserved command buffers");
+    
+    return commandBuffers[commandBufferSet * jobCount + commandBufferIndex];
+}
+
+void Scene::ReserveCommandBuffers(size_t systemCount) {
+    // Set 0 is used outside scheduled systems
+    commandBuffers.resize((systemCount + 1) * (ThreadPool::ThreadCount() + 1));
+}
+
+void Scene::FlushCommands() {
+    for (auto& buffer : commandBuffers) {
+        buffer.Playback(*this);
+    }
+}
+
+void Scene::NotifyObservers() {
+    observers.Notify(*this);
+}
+
+auto Scene::GetGroupStats() const -> GroupStats {
+    return groupStats;
+}
+
+void Scene::ResetGroupStats() {
+    groupStats = {};
+}
+
+auto Scene::Has(Entity entity, ComponentType type) const -> bool {
     auto pool = pools[to_underlying(type)];
     return pool != nullptr && pool->HasComponentFor(entity.id);
 }
@@ -75,17 +110,43 @@ void Scene::ApplyMaskChanges(Entity entity, ComponentMask changes, bool subtract
 }
 
 void Scene::UpdateGroups(Entity entity, ComponentMask newMask) {
-    for (auto group : groups) {
-        bool matchesPrev = group->MatchesGroup(entityIdToMask[entity.id]);
-        bool matchesNew = group->MatchesGroup(newMask);
-        
-        if (matchesNew && !matchesPrev) {
-            group->AddEntity(entity);
+    auto prevMask = entityIdToMask[entity.id];
+    auto changedMask = prevMask ^ newMask;
+    
+    groupStats.maskChanges++;
+    groupStats.scannedGroups += groups.size();
+    
+    ComponentMask visitedMask;
+    
+    for (size_t i = 0; i < COMPONENT_COUNT; i++) {
+        if (!changedMask[i]) {
+            continue;
         }
-        else if (matchesPrev && !matchesNew) {
-            group->RemoveEntity(entity.id);
+        
+        for (auto group : componentGroups[i]) {
+            // Groups mentioning an earlier changed component have already been tested
+            if (((group->requireMask | group->excludeMask) & visitedMask).any()) {
+                continue;
+            }
+            
+            groupStats.groupChecks++;
+            
+            bool matchesPrev = group->MatchesGroup(prevMask);
+            bool matchesNew = group->MatchesGroup(newMask);
+            
+            if (matchesNew && !matchesPrev) {
+                group->AddEntity(entity);
+            }
+            else if (matchesPrev && !matchesNew) {
+                group->RemoveEntity(entity.id);
+            }
         }
+        
+        visitedMask.set(i);
     }
     
+    observers.RecordAdd(entity, newMask & ~prevMask);
+    observers.RecordRemove(entity, prevMask & ~newMask);
+    
     entityIdToMask[entity.id] = newMask;
 }
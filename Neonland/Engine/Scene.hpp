@@ -11,6 +11,9 @@
 #include "ComponentMask.hpp"
 #include "Pool.hpp"
 #include "Group.hpp"
+#include "CommandBuffer.hpp"
+#include "Prefab.hpp"
+#include "ComponentObservers.hpp"
 
 class Scene {
 public:
@@ -23,7 +26,13 @@ public:
     template<Component... Args> requires (sizeof...(Args) > 0 && AllUnique<Args...>)
     auto CreateEntity() -> Entity;
     
+    // Creates count copies of the prefab. initFn(i, components...) customizes the components of the i:th entity.
+    // Pools are appended to and each matching group is updated once for the whole batch.
+    template<Component... Args, typename Func> requires std::invocable<Func, size_t, Args&...>
+    auto Instantiate(const Prefab<Args...>& prefab, size_t count, Func initFn) -> std::vector<Entity>;
+    
     // Destroying entities
+    // Structural changes made while a group is being iterated must go through Commands()
     void DestroyEntity(Entity entity);
     
     // Entity state
@@ -52,32 +61,94 @@ public:
     void Remove(Entity entity);
     
     // Accessing components
+    // T& for regular components, SoALayout<T>::Ref for components stored as structure of arrays
+    template<Component T>
+    auto Get(Entity entity) -> ComponentRef<T>;
+    
+    // Like Get, but stamps nothing, for systems that only Read<T>
     template<Component T>
-    auto Get(Entity entity) -> T&;
+    auto Read(Entity entity) -> ComponentRef<T>;
     
     template<Component T>
     auto GetPool() -> std::shared_ptr<Pool<T>>;
     
+    // Change tracking
+    // Get and group updates stamp the components they hand out. Read, ReadMembers, ReadColumns,
+    // the reads of an update and direct pool access do not.
+    // Writes to components read through a Changed filter are recorded with MarkChanged.
+    template<Component T>
+    void MarkChanged(Entity entity);
+    
+    // Observers
+    // Callbacks receive the entities that gained or lost T since the last NotifyObservers call
+    template<Component T>
+    void OnAdd(ComponentObservers::Callback callback);
+    
+    template<Component T>
+    void OnRemove(ComponentObservers::Callback callback);
+    
+    // Delivers the recorded batches. Must not be called while iterating.
+    void NotifyObservers();
+    
     // Groups
     template<Component... Args> requires (sizeof...(Args) > 0 && AllUnique<Args...>)
     auto GetGroup(ComponentMask exclude = {}) -> std::shared_ptr<Group<Args...>>;
+    
+    // An owning group keeps its members' components packed at the front of each pool in Args,
+    // so it iterates without index lookups. A pool can be owned by only one group, and
+    // an owning group must be requested before any non-owning group with the same masks.
+    template<Component... Args> requires (sizeof...(Args) > 0 && AllUnique<Args...>)
+    auto GetOwningGroup(ComponentMask exclude = {}) -> std::shared_ptr<Group<Args...>>;
+    
+    // Deferred structural changes
+    // Returns the command buffer of the calling UpdateParallel job, in the set of the calling system
+    auto Commands() -> CommandBuffer<Scene>&;
+    
+    // Gives each of systemCount scheduled systems its own set of buffers, so systems that run
+    // concurrently do not share them
+    void ReserveCommandBuffers(size_t systemCount);
+    
+    // Plays back the recorded commands in system and then job order. Must not be called while iterating.
+    void FlushCommands();
+    
+    // Group membership statistics
+    struct GroupStats {
+        size_t maskChanges = 0;
+        // Groups whose membership was tested
+        size_t groupChecks = 0;
+        // Groups a scan over every registered group would have tested
+        size_t scannedGroups = 0;
+    };
+    
+    auto GetGroupStats() const -> GroupStats;
+    void ResetGroupStats();
 private:    
     Entity::Id nextEntityId;
     size_t releasedEntityCount;
     
-    std::mutex destroyMutex;
-    
     std::vector<Entity> sceneEntities;
     
+    std::vector<CommandBuffer<Scene>> commandBuffers;
+    
     std::vector<ComponentMask> entityIdToMask;
     
     std::vector<std::shared_ptr<IPool>> pools;
     std::vector<std::shared_ptr<IGroup>> groups;
     
+    std::atomic<IPool::Version> changeVersion;
+    
+    // Groups whose require or exclude mask contains each component type.
+    // A mask change only needs to test the groups of the changed components.
+    std::array<std::vector<IGroup*>, COMPONENT_COUNT> componentGroups;
+    
+    GroupStats groupStats;
+    
+    ComponentObservers observers;
+    
     auto ReserveEntity() -> Entity;
     void ReleaseEntity(Entity entity);
     
-    auto Has(Entity entity, ComponentType type) -> bool;
+    auto Has(Entity entity, ComponentType type) const -> bool;
     
     auto GetCount(ComponentType type) const -> size_t;
     
@@ -85,6 +156,12 @@ private:
     
     void ApplyMaskChanges(Entity entity, ComponentMask changes, bool subtract);
     
+    template<Component... Args> requires (sizeof...(Args) > 0 && AllUnique<Args...>)
+    auto FindGroup(ComponentMask require, ComponentMask exclude) -> std::shared_ptr<Group<Args...>>;
+    
+    template<Component... Args> requires (sizeof...(Args) > 0 && AllUnique<Args...>)
+    auto CreateGroup(ComponentMask exclude, bool owning) -> std::shared_ptr<Group<Args...>>;
+    
     template<Component T, Component... Args>
     void AddComponentsToPools(Entity::Id entityId, T&& component, Args&&... components);
 };
@@ -101,9 +178,47 @@ auto Scene::CreateEntity() -> Entity {
     return CreateEntity(Args()...);
 }
 
+template<Component... Args, typename Func> requires std::invocable<Func, size_t, Args&...>
+auto Scene::Instantiate(const Prefab<Args...>& prefab, size_t count, Func initFn) -> std::vector<Entity> {
+    std::vector<Entity> entities;
+    entities.reserve(count);
+    
+    for (size_t i = 0; i < count; i++) {
+        entities.push_back(ReserveEntity());
+    }
+    
+    (GetPool<Args>()->Reserve(count), ...);
+    
+    const auto mask = GetComponentMask<Args...>();
+    
+    for (size_t i = 0; i < count; i++) {
+        auto instance = prefab.components;
+        std::apply([&](Args&... components) {
+            initFn(i, components...);
+            AddComponentsToPools(entities[i].id, std::move(components)...);
+        }, instance);
+        
+        entityIdToMask[entities[i].id] = mask;
+    }
+    
+    groupStats.maskChanges++;
+    groupStats.groupChecks += groups.size();
+    groupStats.scannedGroups += groups.size();
+    
+    for (auto& group : groups) {
+        if (group->MatchesGroup(mask)) {
+            group->AddEntities(entities);
+        }
+    }
+    
+    observers.RecordAdd(entities, mask);
+    
+    return entities;
+}
+
 template<Component T>
 auto Scene::Has(Entity entity) const -> bool {
-    Has(entity, T::componentType);
+    return Has(entity, T::componentType);
 }
 
 template<Component... Args> requires (sizeof...(Args) > 0 && AllUnique<Args...>)
@@ -125,12 +240,21 @@ void Scene::Add(const std::vector<Entity>& entities) {
 template<Component T>
 void Scene::Remove(Entity entity) {
     assert(IsAlive(entity) && "Entity must be alive");
-    GetPool<T>()->RemoveComponent(entity.id);
+    // Groups are updated first so owning groups can move the component out of their packed range
     ApplyMaskChanges(entity, GetComponentMask<T>(), true);
+    GetPool<T>()->RemoveComponent(entity.id);
+}
+
+template<Component T>
+auto Scene::Get(Entity entity) -> ComponentRef<T> {
+    assert(IsAlive(entity) && "Entity must be alive");
+    auto pool = GetPool<T>();
+    pool->MarkChanged(entity.id);
+    return pool->GetComponent(entity.id);
 }
 
 template<Component T>
-auto Scene::Get(Entity entity) -> T& {
+auto Scene::Read(Entity entity) -> ComponentRef<T> {
     assert(IsAlive(entity) && "Entity must be alive");
     return GetPool<T>()->GetComponent(entity.id);
 }
@@ -141,23 +265,74 @@ auto Scene::GetPool() -> std::shared_ptr<Pool<T>> {
     
     if (pools[type] == nullptr) {
         pools[type] = std::make_shared<Pool<T>>();
+        pools[type]->sceneVersion = &changeVersion;
     }
     
     return std::static_pointer_cast<Pool<T>>(pools[type]);
 }
 
+template<Component T>
+void Scene::MarkChanged(Entity entity) {
+    assert(IsAlive(entity) && "Entity must be alive");
+    GetPool<T>()->MarkChanged(entity.id);
+}
+
+template<Component T>
+void Scene::OnAdd(ComponentObservers::Callback callback) {
+    observers.OnAdd(T::componentType, std::move(callback));
+}
+
+template<Component T>
+void Scene::OnRemove(ComponentObservers::Callback callback) {
+    observers.OnRemove(T::componentType, std::move(callback));
+}
+
 template<Component... Args> requires (sizeof...(Args) > 0 && AllUnique<Args...>)
 auto Scene::GetGroup(ComponentMask exclude) -> std::shared_ptr<Group<Args...>> {
-    auto require = GetComponentMask<Args...>();
-    exclude = exclude & ~require;
+    exclude = exclude & ~GetComponentMask<Args...>();
+    
+    if (auto group = FindGroup<Args...>(GetComponentMask<Args...>(), exclude)) {
+        return group;
+    }
     
+    return CreateGroup<Args...>(exclude, false);
+}
+
+template<Component... Args> requires (sizeof...(Args) > 0 && AllUnique<Args...>)
+auto Scene::GetOwningGroup(ComponentMask exclude) -> std::shared_ptr<Group<Args...>> {
+    exclude = exclude & ~GetComponentMask<Args...>();
+    
+    if (auto group = FindGroup<Args...>(GetComponentMask<Args...>(), exclude)) {
+        assert(group->IsOwning() && "Group already exists as a non-owning group");
+        return group;
+    }
+    
+    return CreateGroup<Args...>(exclude, true);
+}
+
+template<Component... Args> requires (sizeof...(Args) > 0 && AllUnique<Args...>)
+auto Scene::FindGroup(ComponentMask require, ComponentMask exclude) -> std::shared_ptr<Group<Args...>> {
     for (auto group : groups) {
         if (group->requireMask == require && group->excludeMask == exclude) {
             return std::static_pointer_cast<Group<Args...>>(group);
         }
     }
     
+    return nullptr;
+}
+
+template<Component... Args> requires (sizeof...(Args) > 0 && AllUnique<Args...>)
+auto Scene::CreateGroup(ComponentMask exclude, bool owning) -> std::shared_ptr<Group<Args...>> {
     auto group = std::make_shared<Group<Args...>>(exclude, GetPool<Args>()...);
+    group->sceneVersion = &changeVersion;
+    
+    if (owning) {
+        for (auto pool : { std::static_pointer_cast<IPool>(GetPool<Args>())... }) {
+            assert(pool->owner == nullptr && "Pool cannot be owned by more than one group");
+            pool->owner = group.get();
+            group->ownedPools.push_back(pool.get());
+        }
+    }
     
     constexpr auto types = std::array<ComponentType, sizeof...(Args)> { Args::componentType... };
     
@@ -173,9 +348,10 @@ auto Scene::GetGroup(ComponentMask exclude) -> std::shared_ptr<Group<Args...>> {
     }
     
     if (minCount > 0) {
-        auto pool = pools[to_underlying(rarestType)];
+        // Copied because adding to an owning group reorders the pools
+        auto entityIds = pools[to_underlying(rarestType)]->indexToEntityId;
         
-        for (auto entityId : pool->indexToEntityId) {
+        for (auto entityId : entityIds) {
             auto mask = entityIdToMask[entityId];
             if (group->MatchesGroup(mask)) {
                 group->AddEntity(sceneEntities[entityId]);
@@ -184,6 +360,14 @@ auto Scene::GetGroup(ComponentMask exclude) -> std::shared_ptr<Group<Args...>> {
     }
     
     groups.push_back(group);
+    
+    auto mentionedMask = group->requireMask | group->excludeMask;
+    for (size_t i = 0; i < COMPONENT_COUNT; i++) {
+        if (mentionedMask[i]) {
+            componentGroups[i].push_back(group.get());
+        }
+    }
+    
     return group;
 }
 
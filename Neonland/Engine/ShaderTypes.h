@@ -28,3 +28,18 @@ typedef struct Instance {
 
 #endif
 
+#ifndef __METAL_VERSION__
+#include <stdint.h>
+#endif
+
+// Instance in 28 bytes instead of 80, for scenes that mostly turn around z. Decoded to the same
+// model matrix T * Rz * Ry * Rx * S as Instance. Only the Metal shaders read it, see Neon_RenderCompactInto.
+typedef struct CompactInstance {
+    float position[3];
+    // color * tint as RGBA8, red in the lowest byte
+    uint32_t color;
+    // Euler angles around x, y and z in 1/65536 turns
+    uint16_t rotation[3];
+    // IEEE half floats
+    uint16_t scale[3];
+} CompactInstance;
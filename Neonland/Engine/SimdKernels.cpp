@@ -0,0 +1,523 @@
+#include "SimdKernels.hpp"
+
+#include <cmath>
+#include <bit>
+#include <cstring>
+#include <cassert>
+
+#include "MathUtils.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+#include <arm_neon.h>
+#endif
+
+// The kernels are written once against the few operations below, which each target defines for its
+// widest vector. The scalar fallback is a vector of one lane.
+namespace {
+#if defined(__AVX2__)
+    constexpr const char* target = "AVX2";
+    constexpr size_t lanes = 8;
+    using Vec = __m256;
+    
+    auto Load(const float* p) -> Vec { return _mm256_loadu_ps(p); }
+    void Store(float* p, Vec v) { _mm256_storeu_ps(p, v); }
+    auto Splat(float f) -> Vec { return _mm256_set1_ps(f); }
+    auto Add(Vec a, Vec b) -> Vec { return _mm256_add_ps(a, b); }
+    auto Sub(Vec a, Vec b) -> Vec { return _mm256_sub_ps(a, b); }
+    auto Mul(Vec a, Vec b) -> Vec { return _mm256_mul_ps(a, b); }
+    // Same operand order as std::min, which keeps a unless b is smaller
+    auto Min(Vec a, Vec b) -> Vec { return _mm256_min_ps(b, a); }
+    auto Max(Vec a, Vec b) -> Vec { return _mm256_max_ps(b, a); }
+    auto Sqrt(Vec v) -> Vec { return _mm256_sqrt_ps(v); }
+    // Bit i is set if a < b in lane i
+    auto LessMask(Vec a, Vec b) -> uint32_t { return static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_LT_OQ))); }
+    auto ZeroMask(Vec v) -> uint32_t { return static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(v, _mm256_setzero_ps(), _CMP_EQ_OQ))); }
+    
+    // Lane masks of the bits of integer vectors
+    using Int = __m256i;
+    using Mask = __m256;
+    
+    // Rounds to nearest, ties to even
+    auto RoundToInt(Vec v) -> Int { return _mm256_cvtps_epi32(v); }
+    auto ToFloat(Int n) -> Vec { return _mm256_cvtepi32_ps(n); }
+    auto AddInt(Int n, int32_t i) -> Int { return _mm256_add_epi32(n, _mm256_set1_epi32(i)); }
+    auto BitSet(Int n, int32_t bit) -> Mask {
+        const Int bits = _mm256_set1_epi32(bit);
+        return _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(n, bits), bits));
+    }
+    auto Select(Mask mask, Vec a, Vec b) -> Vec { return _mm256_blendv_ps(b, a, mask); }
+    
+    void StoreInt(int32_t* p, Int n) { _mm256_storeu_si256(reinterpret_cast<Int*>(p), n); }
+    auto SplatInt(int32_t i) -> Int { return _mm256_set1_epi32(i); }
+    auto AsInt(Vec v) -> Int { return _mm256_castps_si256(v); }
+    auto AsFloat(Int n) -> Vec { return _mm256_castsi256_ps(n); }
+    auto AddInts(Int a, Int b) -> Int { return _mm256_add_epi32(a, b); }
+    auto And(Int n, int32_t bits) -> Int { return _mm256_and_si256(n, _mm256_set1_epi32(bits)); }
+    auto Or(Int a, Int b) -> Int { return _mm256_or_si256(a, b); }
+    // Logical shifts
+    auto ShiftLeft(Int n, int bits) -> Int { return _mm256_sll_epi32(n, _mm_cvtsi32_si128(bits)); }
+    auto ShiftRight(Int n, int bits) -> Int { return _mm256_srl_epi32(n, _mm_cvtsi32_si128(bits)); }
+    auto LessInt(Int n, int32_t i) -> Mask { return _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(i), n)); }
+    auto Select(Mask mask, Int a, Int b) -> Int { return _mm256_blendv_epi8(b, a, _mm256_castps_si256(mask)); }
+    
+    // Writes a[i], b[i], c[i] and d[i] to base + i * stride for each lane i
+    void StoreQuads(float* base, size_t stride, Vec a, Vec b, Vec c, Vec d) {
+        const Vec ab0 = _mm256_unpacklo_ps(a, b);
+        const Vec ab1 = _mm256_unpackhi_ps(a, b);
+        const Vec cd0 = _mm256_unpacklo_ps(c, d);
+        const Vec cd1 = _mm256_unpackhi_ps(c, d);
+        
+        // Lanes i and i + 4 of each quad are in the two halves of q[i]
+        const Vec q[] = {
+            _mm256_shuffle_ps(ab0, cd0, _MM_SHUFFLE(1, 0, 1, 0)),
+            _mm256_shuffle_ps(ab0, cd0, _MM_SHUFFLE(3, 2, 3, 2)),
+            _mm256_shuffle_ps(ab1, cd1, _MM_SHUFFLE(1, 0, 1, 0)),
+            _mm256_shuffle_ps(ab1, cd1, _MM_SHUFFLE(3, 2, 3, 2)),
+        };
+        
+        for (size_t i = 0; i < 4; i++) {
+            _mm_storeu_ps(base + i * stride, _mm256_castps256_ps128(q[i]));
+            _mm_storeu_ps(base + (i + 4) * stride, _mm256_extractf128_ps(q[i], 1));
+        }
+    }
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    constexpr const char* target = "SSE2";
+    constexpr size_t lanes = 4;
+    using Vec = __m128;
+    
+    auto Load(const float* p) -> Vec { return _mm_loadu_ps(p); }
+    void Store(float* p, Vec v) { _mm_storeu_ps(p, v); }
+    auto Splat(float f) -> Vec { return _mm_set1_ps(f); }
+    auto Add(Vec a, Vec b) -> Vec { return _mm_add_ps(a, b); }
+    auto Sub(Vec a, Vec b) -> Vec { return _mm_sub_ps(a, b); }
+    auto Mul(Vec a, Vec b) -> Vec { return _mm_mul_ps(a, b); }
+    auto Min(Vec a, Vec b) -> Vec { return _mm_min_ps(b, a); }
+    auto Max(Vec a, Vec b) -> Vec { return _mm_max_ps(b, a); }
+    auto Sqrt(Vec v) -> Vec { return _mm_sqrt_ps(v); }
+    auto LessMask(Vec a, Vec b) -> uint32_t { return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmplt_ps(a, b))); }
+    auto ZeroMask(Vec v) -> uint32_t { return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmpeq_ps(v, _mm_setzero_ps()))); }
+    
+    using Int = __m128i;
+    using Mask = __m128;
+    
+    auto RoundToInt(Vec v) -> Int { return _mm_cvtps_epi32(v); }
+    auto ToFloat(Int n) -> Vec { return _mm_cvtepi32_ps(n); }
+    auto AddInt(Int n, int32_t i) -> Int { return _mm_add_epi32(n, _mm_set1_epi32(i)); }
+    auto BitSet(Int n, int32_t bit) -> Mask {
+        const Int bits = _mm_set1_epi32(bit);
+        return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(n, bits), bits));
+    }
+    auto Select(Mask mask, Vec a, Vec b) -> Vec { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+    
+    void StoreInt(int32_t* p, Int n) { _mm_storeu_si128(reinterpret_cast<Int*>(p), n); }
+    auto SplatInt(int32_t i) -> Int { return _mm_set1_epi32(i); }
+    auto AsInt(Vec v) -> Int { return _mm_castps_si128(v); }
+    auto AsFloat(Int n) -> Vec { return _mm_castsi128_ps(n); }
+    auto AddInts(Int a, Int b) -> Int { return _mm_add_epi32(a, b); }
+    auto And(Int n, int32_t bits) -> Int { return _mm_and_si128(n, _mm_set1_epi32(bits)); }
+    auto Or(Int a, Int b) -> Int { return _mm_or_si128(a, b); }
+    auto ShiftLeft(Int n, int bits) -> Int { return _mm_sll_epi32(n, _mm_cvtsi32_si128(bits)); }
+    auto ShiftRight(Int n, int bits) -> Int { return _mm_srl_epi32(n, _mm_cvtsi32_si128(bits)); }
+    auto LessInt(Int n, int32_t i) -> Mask { return _mm_castsi128_ps(_mm_cmplt_epi32(n, _mm_set1_epi32(i))); }
+    auto Select(Mask mask, Int a, Int b) -> Int {
+        const Int bits = _mm_castps_si128(mask);
+        return _mm_or_si128(_mm_and_si128(bits, a), _mm_andnot_si128(bits, b));
+    }
+    
+    void StoreQuads(float* base, size_t stride, Vec a, Vec b, Vec c, Vec d) {
+        _MM_TRANSPOSE4_PS(a, b, c, d);
+        _mm_storeu_ps(base, a);
+        _mm_storeu_ps(base + stride, b);
+        _mm_storeu_ps(base + 2 * stride, c);
+        _mm_storeu_ps(base + 3 * stride, d);
+    }
+#elif defined(__ARM_NEON) && (defined(__aarch64__) || defined(_M_ARM64))
+    constexpr const char* target = "NEON";
+    constexpr size_t lanes = 4;
+    using Vec = float32x4_t;
+    
+    auto Load(const float* p) -> Vec { return vld1q_f32(p); }
+    void Store(float* p, Vec v) { vst1q_f32(p, v); }
+    auto Splat(float f) -> Vec { return vdupq_n_f32(f); }
+    auto Add(Vec a, Vec b) -> Vec { return vaddq_f32(a, b); }
+    auto Sub(Vec a, Vec b) -> Vec { return vsubq_f32(a, b); }
+    auto Mul(Vec a, Vec b) -> Vec { return vmulq_f32(a, b); }
+    auto Min(Vec a, Vec b) -> Vec { return vbslq_f32(vcltq_f32(b, a), b, a); }
+    auto Max(Vec a, Vec b) -> Vec { return vbslq_f32(vcgtq_f32(b, a), b, a); }
+    auto Sqrt(Vec v) -> Vec { return vsqrtq_f32(v); }
+    auto LessMask(Vec a, Vec b) -> uint32_t {
+        static constexpr uint32_t bits[] = {1, 2, 4, 8};
+        return vaddvq_u32(vandq_u32(vcltq_f32(a, b), vld1q_u32(bits)));
+    }
+    auto ZeroMask(Vec v) -> uint32_t {
+        static constexpr uint32_t bits[] = {1, 2, 4, 8};
+        return vaddvq_u32(vandq_u32(vceqq_f32(v, vdupq_n_f32(0)), vld1q_u32(bits)));
+    }
+    
+    using Int = int32x4_t;
+    using Mask = uint32x4_t;
+    
+    auto RoundToInt(Vec v) -> Int { return vcvtnq_s32_f32(v); }
+    auto ToFloat(Int n) -> Vec { return vcvtq_f32_s32(n); }
+    auto AddInt(Int n, int32_t i) -> Int { return vaddq_s32(n, vdupq_n_s32(i)); }
+    auto BitSet(Int n, int32_t bit) -> Mask { return vtstq_s32(n, vdupq_n_s32(bit)); }
+    auto Select(Mask mask, Vec a, Vec b) -> Vec { return vbslq_f32(mask, a, b); }
+    
+    void StoreInt(int32_t* p, Int n) { vst1q_s32(p, n); }
+    auto SplatInt(int32_t i) -> Int { return vdupq_n_s32(i); }
+    auto AsInt(Vec v) -> Int { return vreinterpretq_s32_f32(v); }
+    auto AsFloat(Int n) -> Vec { return vreinterpretq_f32_s32(n); }
+    auto AddInts(Int a, Int b) -> Int { return vaddq_s32(a, b); }
+    auto And(Int n, int32_t bits) -> Int { return vandq_s32(n, vdupq_n_s32(bits)); }
+    auto Or(Int a, Int b) -> Int { return vorrq_s32(a, b); }
+    auto ShiftLeft(Int n, int bits) -> Int { return vshlq_s32(n, vdupq_n_s32(bits)); }
+    auto ShiftRight(Int n, int bits) -> Int { return vreinterpretq_s32_u32(vshlq_u32(vreinterpretq_u32_s32(n), vdupq_n_s32(-bits))); }
+    auto LessInt(Int n, int32_t i) -> Mask { return vcltq_s32(n, vdupq_n_s32(i)); }
+    auto Select(Mask mask, Int a, Int b) -> Int { return vbslq_s32(mask, a, b); }
+    
+    void StoreQuads(float* base, size_t stride, Vec a, Vec b, Vec c, Vec d) {
+        const float32x4x4_t quads = {{a, b, c, d}};
+        vst4q_lane_f32(base, quads, 0);
+        vst4q_lane_f32(base + stride, quads, 1);
+        vst4q_lane_f32(base + 2 * stride, quads, 2);
+        vst4q_lane_f32(base + 3 * stride, quads, 3);
+    }
+#else
+    constexpr const char* target = "Scalar";
+    constexpr size_t lanes = 1;
+    using Vec = float;
+    
+    auto Load(const float* p) -> Vec { return *p; }
+    void Store(float* p, Vec v) { *p = v; }
+    auto Splat(float f) -> Vec { return f; }
+    auto Add(Vec a, Vec b) -> Vec { return a + b; }
+    auto Sub(Vec a, Vec b) -> Vec { return a - b; }
+    auto Mul(Vec a, Vec b) -> Vec { return a * b; }
+    auto Min(Vec a, Vec b) -> Vec { return std::min(a, b); }
+    auto Max(Vec a, Vec b) -> Vec { return std::max(a, b); }
+    auto Sqrt(Vec v) -> Vec { return std::sqrt(v); }
+    auto LessMask(Vec a, Vec b) -> uint32_t { return a < b ? 1 : 0; }
+    auto ZeroMask(Vec v) -> uint32_t { return v == 0 ? 1 : 0; }
+    
+    using Int = int32_t;
+    using Mask = bool;
+    
+    auto RoundToInt(Vec v) -> Int { return static_cast<Int>(std::nearbyint(v)); }
+    auto ToFloat(Int n) -> Vec { return static_cast<Vec>(n); }
+    auto AddInt(Int n, int32_t i) -> Int { return n + i; }
+    auto BitSet(Int n, int32_t bit) -> Mask { return (n & bit) != 0; }
+    auto Select(Mask mask, Vec a, Vec b) -> Vec { return mask ? a : b; }
+    
+    void StoreInt(int32_t* p, Int n) { *p = n; }
+    auto SplatInt(int32_t i) -> Int { return i; }
+    auto AsInt(Vec v) -> Int { return std::bit_cast<Int>(v); }
+    auto AsFloat(Int n) -> Vec { return std::bit_cast<Vec>(n); }
+    auto AddInts(Int a, Int b) -> Int { return static_cast<Int>(static_cast<uint32_t>(a) + static_cast<uint32_t>(b)); }
+    auto And(Int n, int32_t bits) -> Int { return n & bits; }
+    auto Or(Int a, Int b) -> Int { return a | b; }
+    auto ShiftLeft(Int n, int bits) -> Int { return static_cast<Int>(static_cast<uint32_t>(n) << bits); }
+    auto ShiftRight(Int n, int bits) -> Int { return static_cast<Int>(static_cast<uint32_t>(n) >> bits); }
+    auto LessInt(Int n, int32_t i) -> Mask { return n < i; }
+    auto Select(Mask mask, Int a, Int b) -> Int { return mask ? a : b; }
+    
+    void StoreQuads(float* base, size_t stride, Vec a, Vec b, Vec c, Vec d) {
+        base[0] = a;
+        base[1] = b;
+        base[2] = c;
+        base[3] = d;
+    }
+#endif
+}
+
+namespace {
+    // sin and cos of angles in degrees, within 1e-7 of the exact values. The angle is reduced to
+    // [-45, 45] degrees around the nearest multiple of 90, exactly for angles up to about 1.6e7 degrees,
+    // and evaluated with the polynomials for [-pi/4, pi/4] from Cephes' sinf and cosf.
+    void SinCosDegrees(Vec degrees, Vec& sin, Vec& cos) {
+        const Int quadrant = RoundToInt(Mul(degrees, Splat(1.0f / 90)));
+        const Vec x = Mul(Sub(degrees, Mul(ToFloat(quadrant), Splat(90))), Splat(DegToRad));
+        const Vec z = Mul(x, x);
+        
+        Vec s = Add(Mul(Splat(-1.9515295891e-4f), z), Splat(8.3321608736e-3f));
+        s = Add(Mul(s, z), Splat(-1.6666654611e-1f));
+        s = Add(Mul(Mul(s, z), x), x);
+        
+        Vec c = Add(Mul(Splat(2.443315711809948e-5f), z), Splat(-1.388731625493765e-3f));
+        c = Add(Mul(c, z), Splat(4.166664568298827e-2f));
+        c = Add(Sub(Splat(1), Mul(Splat(0.5f), z)), Mul(Mul(c, z), z));
+        
+        // Odd quadrants swap sin and cos, quadrants 2 and 3 negate sin, 1 and 2 negate cos
+        const Mask swap = BitSet(quadrant, 1);
+        const Vec sinX = Select(swap, c, s);
+        const Vec cosX = Select(swap, s, c);
+        
+        sin = Select(BitSet(quadrant, 2), Sub(Splat(0), sinX), sinX);
+        cos = Select(BitSet(AddInt(quadrant, 1), 2), Sub(Splat(0), cosX), cosX);
+    }
+    
+    // Composes the instances of the lanes starting at block index begin. Only the first used lanes
+    // choose the path, so the result of a lane does not depend on unused ones.
+    void ComposeLanes(const InstanceBlock& block, size_t begin, size_t used, Instance* out) {
+        const Vec rotationX = Load(block.rotationX + begin);
+        const Vec rotationY = Load(block.rotationY + begin);
+        
+        Vec sinZ, cosZ;
+        SinCosDegrees(Load(block.rotationZ + begin), sinZ, cosZ);
+        
+        // Rows of Rz * Ry * Rx
+        Vec r00 = cosZ, r01 = Sub(Splat(0), sinZ), r02 = Splat(0);
+        Vec r10 = sinZ, r11 = cosZ, r12 = Splat(0);
+        Vec r20 = Splat(0), r21 = Splat(0), r22 = Splat(1);
+        
+        const uint32_t usedLanes = (1u << used) - 1;
+        
+        // Almost everything only turns around z
+        if ((ZeroMask(rotationX) & ZeroMask(rotationY) & usedLanes) != usedLanes) {
+            Vec sinX, cosX, sinY, cosY;
+            SinCosDegrees(rotationX, sinX, cosX);
+            SinCosDegrees(rotationY, sinY, cosY);
+            
+            const Vec sinYSinX = Mul(sinY, sinX);
+            const Vec sinYCosX = Mul(sinY, cosX);
+            
+            r00 = Mul(cosZ, cosY);
+            r01 = Sub(Mul(cosZ, sinYSinX), Mul(sinZ, cosX));
+            r02 = Add(Mul(cosZ, sinYCosX), Mul(sinZ, sinX));
+            r10 = Mul(sinZ, cosY);
+            r11 = Add(Mul(sinZ, sinYSinX), Mul(cosZ, cosX));
+            r12 = Sub(Mul(sinZ, sinYCosX), Mul(cosZ, sinX));
+            r20 = Sub(Splat(0), sinY);
+            r21 = Mul(cosY, sinX);
+            r22 = Mul(cosY, cosX);
+        }
+        
+        const Vec scaleX = Load(block.scaleX + begin);
+        const Vec scaleY = Load(block.scaleY + begin);
+        const Vec scaleZ = Load(block.scaleZ + begin);
+        
+        const Vec m00 = Mul(r00, scaleX), m01 = Mul(r01, scaleY), m02 = Mul(r02, scaleZ);
+        const Vec m10 = Mul(r10, scaleX), m11 = Mul(r11, scaleY), m12 = Mul(r12, scaleZ);
+        const Vec m20 = Mul(r20, scaleX), m21 = Mul(r21, scaleY), m22 = Mul(r22, scaleZ);
+        
+        const Vec positionX = Load(block.positionX + begin);
+        const Vec positionY = Load(block.positionY + begin);
+        const Vec positionZ = Load(block.positionZ + begin);
+        
+        const Vec zero = Splat(0);
+        const Vec one = Splat(1);
+        
+        constexpr size_t stride = sizeof(Instance) / sizeof(float);
+        float* transform = reinterpret_cast<float*>(&out->transform);
+        float* color = reinterpret_cast<float*>(&out->color);
+
+#ifdef _WIN64
+        // Rows, as GetFrameData used to transpose the DirectX matrix
+        StoreQuads(transform, stride, m00, m01, m02, positionX);
+        StoreQuads(transform + 4, stride, m10, m11, m12, positionY);
+        StoreQuads(transform + 8, stride, m20, m21, m22, positionZ);
+        StoreQuads(transform + 12, stride, zero, zero, zero, one);
+#else
+        StoreQuads(transform, stride, m00, m10, m20, zero);
+        StoreQuads(transform + 4, stride, m01, m11, m21, zero);
+        StoreQuads(transform + 8, stride, m02, m12, m22, zero);
+        StoreQuads(transform + 12, stride, positionX, positionY, positionZ, one);
+#endif
+        
+        StoreQuads(color, stride,
+                   Mul(Load(block.colorR + begin), Load(block.tintR + begin)),
+                   Mul(Load(block.colorG + begin), Load(block.tintG + begin)),
+                   Mul(Load(block.colorB + begin), Load(block.tintB + begin)),
+                   Mul(Load(block.colorA + begin), Load(block.tintA + begin)));
+    }
+    
+    // The encoders below round exactly like EncodeCompactInstance
+    
+    // Whole turns are removed, the rest is rounded to 1/65536 of a turn. The low 16 bits are the angle.
+    auto AngleSteps(Vec degrees) -> Int {
+        const Vec turns = ToFloat(RoundToInt(Mul(degrees, Splat(1.0f / 360))));
+        return RoundToInt(Mul(Sub(degrees, Mul(turns, Splat(360))), Splat(65536.0f / 360)));
+    }
+    
+    auto ColorChannel(const float* color, const float* tint) -> Int {
+        const Vec value = Mul(Load(color), Load(tint));
+        return RoundToInt(Mul(Min(Max(value, Splat(0)), Splat(1)), Splat(255)));
+    }
+    
+    // IEEE half floats in the low 16 bits, as FloatToHalf
+    auto HalfBits(Vec v) -> Int {
+        const Int bits = AsInt(v);
+        const Int sign = ShiftLeft(ShiftRight(bits, 31), 15);
+        const Int magnitude = And(bits, 0x7fffffff);
+        
+        // Values from 65536 up become infinity like those rounding up to it
+        const Int clamped = AsInt(Min(AsFloat(magnitude), Splat(65536.0f)));
+        const Int rebiased = AddInt(clamped, 0xfff - (112 << 23));
+        const Int normal = ShiftRight(AddInts(rebiased, And(ShiftRight(clamped, 13), 1)), 13);
+        const Int subnormal = AddInt(AsInt(Add(AsFloat(magnitude), Splat(0.5f))), -std::bit_cast<int32_t>(0.5f));
+        
+        Int half = Select(LessInt(magnitude, 0x38800000), subnormal, normal);
+        half = Select(LessInt(magnitude, 0x7f800001), half, SplatInt(0x7e00));
+        return Or(sign, half);
+    }
+}
+
+auto SimdKernelTarget() -> const char* {
+    return target;
+}
+
+void IntegrateArray(float* values, float* previous, const float* rates, float timestep, size_t count) {
+    const Vec step = Splat(timestep);
+    
+    size_t i = 0;
+    for (; i + lanes <= count; i += lanes) {
+        const Vec value = Load(values + i);
+        Store(previous + i, value);
+        Store(values + i, Add(value, Mul(Load(rates + i), step)));
+    }
+    
+    for (; i < count; i++) {
+        previous[i] = values[i];
+        values[i] = values[i] + rates[i] * timestep;
+    }
+}
+
+void ScaleRadii(const float* collisionRadii, const float* scaleX, const float* scaleY, const float* scaleZ,
+                float* radii, size_t count) {
+    size_t i = 0;
+    for (; i + lanes <= count; i += lanes) {
+        const Vec scale = Min(Min(Load(scaleX + i), Load(scaleY + i)), Load(scaleZ + i));
+        Store(radii + i, Mul(Load(collisionRadii + i), scale));
+    }
+    
+    for (; i < count; i++) {
+        radii[i] = collisionRadii[i] * std::min(std::min(scaleX[i], scaleY[i]), scaleZ[i]);
+    }
+}
+
+auto OverlapCircles(CircleArrays circles, float x, float y, float radius, float epsilon, uint32_t* out) -> size_t {
+    const Vec centerX = Splat(x);
+    const Vec centerY = Splat(y);
+    const Vec reach = Splat(radius);
+    const Vec slack = Splat(epsilon);
+    
+    size_t found = 0;
+    
+    size_t i = 0;
+    for (; i + lanes <= circles.count; i += lanes) {
+        const Vec dx = Sub(Load(circles.x + i), centerX);
+        const Vec dy = Sub(Load(circles.y + i), centerY);
+        const Vec distance = Sqrt(Add(Mul(dx, dx), Mul(dy, dy)));
+        
+        for (uint32_t mask = LessMask(Sub(distance, slack), Add(Load(circles.radius + i), reach)); mask != 0; mask &= mask - 1) {
+            out[found++] = static_cast<uint32_t>(i) + static_cast<uint32_t>(std::countr_zero(mask));
+        }
+    }
+    
+    for (; i < circles.count; i++) {
+        const float dx = circles.x[i] - x;
+        const float dy = circles.y[i] - y;
+        
+        if (std::sqrt(dx * dx + dy * dy) - epsilon < circles.radius[i] + radius) {
+            out[found++] = static_cast<uint32_t>(i);
+        }
+    }
+    
+    return found;
+}
+
+void CullSweptSpheres(const Frustum& frustum, SweptSphereArrays spheres, uint8_t* culled) {
+    const auto& planes = frustum.Planes();
+    
+    size_t i = 0;
+    for (; i + lanes <= spheres.count; i += lanes) {
+        const Vec startX = Load(spheres.startX + i);
+        const Vec startY = Load(spheres.startY + i);
+        const Vec startZ = Load(spheres.startZ + i);
+        const Vec endX = Load(spheres.endX + i);
+        const Vec endY = Load(spheres.endY + i);
+        const Vec endZ = Load(spheres.endZ + i);
+        const Vec reach = Sub(Splat(0), Load(spheres.radius + i));
+        
+        uint32_t outside = 0;
+        for (const auto& plane : planes) {
+            const Vec nx = Splat(plane.x);
+            const Vec ny = Splat(plane.y);
+            const Vec nz = Splat(plane.z);
+            const Vec d = Splat(plane.w);
+            
+            const Vec startDistance = Add(Add(Add(Mul(nx, startX), Mul(ny, startY)), Mul(nz, startZ)), d);
+            const Vec endDistance = Add(Add(Add(Mul(nx, endX), Mul(ny, endY)), Mul(nz, endZ)), d);
+            outside |= LessMask(startDistance, reach) & LessMask(endDistance, reach);
+        }
+        
+        for (size_t lane = 0; lane < lanes; lane++) {
+            culled[i + lane] = (outside >> lane) & 1;
+        }
+    }
+    
+    for (; i < spheres.count; i++) {
+        const float3 start = {spheres.startX[i], spheres.startY[i], spheres.startZ[i]};
+        const float3 end = {spheres.endX[i], spheres.endY[i], spheres.endZ[i]};
+        culled[i] = !frustum.IntersectsSweep(start, end, spheres.radius[i]);
+    }
+}
+
+void ComposeInstances(const InstanceBlock& block, size_t count, Instance* out) {
+    assert(count <= InstanceBlock::capacity && "Blocks hold at most InstanceBlock::capacity instances");
+    
+    size_t i = 0;
+    for (; i + lanes <= count; i += lanes) {
+        ComposeLanes(block, i, lanes, out + i);
+    }
+    
+    // The block's arrays are padded to whole vectors, only the lanes in use are copied out
+    if (i < count) {
+        Instance tail[lanes];
+        ComposeLanes(block, i, count - i, tail);
+        std::memcpy(out + i, tail, (count - i) * sizeof(Instance));
+    }
+}
+
+void ComposeCompactInstances(const InstanceBlock& block, size_t count, CompactInstance* out) {
+    assert(count <= InstanceBlock::capacity && "Blocks hold at most InstanceBlock::capacity instances");
+    
+    for (size_t i = 0; i < count; i += lanes) {
+        // Encoded a vector at a time and copied out an instance at a time
+        int32_t color[lanes];
+        int32_t rotation[3][lanes];
+        int32_t scale[3][lanes];
+        
+        const Int r = ColorChannel(block.colorR + i, block.tintR + i);
+        const Int g = ColorChannel(block.colorG + i, block.tintG + i);
+        const Int b = ColorChannel(block.colorB + i, block.tintB + i);
+        const Int a = ColorChannel(block.colorA + i, block.tintA + i);
+        StoreInt(color, Or(Or(r, ShiftLeft(g, 8)), Or(ShiftLeft(b, 16), ShiftLeft(a, 24))));
+        
+        StoreInt(rotation[0], AngleSteps(Load(block.rotationX + i)));
+        StoreInt(rotation[1], AngleSteps(Load(block.rotationY + i)));
+        StoreInt(rotation[2], AngleSteps(Load(block.rotationZ + i)));
+        
+        StoreInt(scale[0], HalfBits(Load(block.scaleX + i)));
+        StoreInt(scale[1], HalfBits(Load(block.scaleY + i)));
+        StoreInt(scale[2], HalfBits(Load(block.scaleZ + i)));
+        
+        const size_t used = std::min(lanes, count - i);
+        for (size_t lane = 0; lane < used; lane++) {
+            CompactInstance& instance = out[i + lane];
+            
+            instance.position[0] = block.positionX[i + lane];
+            instance.position[1] = block.positionY[i + lane];
+            instance.position[2] = block.positionZ[i + lane];
+            instance.color = static_cast<uint32_t>(color[lane]);
+            
+            for (size_t axis = 0; axis < 3; axis++) {
+                instance.rotation[axis] = static_cast<uint16_t>(rotation[axis][lane]);
+                instance.scale[axis] = static_cast<uint16_t>(scale[axis][lane]);
+            }
+        }
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <concepts>
+#include <algorithm>
+
+#include "ShaderTypes.h"
+#include "Frustum.hpp"
+
+// Kernels over contiguous float arrays such as the columns of SoA components.
+// They use AVX2, SSE2 or NEON when the build targets them and plain loops otherwise.
+// Every path rounds like the scalar code, so results do not depend on the instruction set.
+
+// Instruction set the kernels were built for: "AVX2", "SSE2", "NEON" or "Scalar"
+auto SimdKernelTarget() -> const char*;
+
+// previous[i] = values[i], then values[i] += rates[i] * timestep
+void IntegrateArray(float* values, float* previous, const float* rates, float timestep, size_t count);
+
+// radii[i] = collisionRadii[i] * min(scaleX[i], scaleY[i], scaleZ[i])
+void ScaleRadii(const float* collisionRadii, const float* scaleX, const float* scaleY, const float* scaleZ,
+                float* radii, size_t count);
+
+// Circles in the xy plane, one per index
+struct CircleArrays {
+    const float* x;
+    const float* y;
+    const float* radius;
+    size_t count;
+};
+
+// Writes the indices of the circles that overlap the circle at (x, y) to out in ascending order and
+// returns how many there were. out must have room for circles.count indices.
+// Overlapping is tested as in Physics::Overlapping: distance - epsilon < sum of the radii.
+auto OverlapCircles(CircleArrays circles, float x, float y, float radius, float epsilon, uint32_t* out) -> size_t;
+
+// Spheres moving in straight lines from start to end, one per index
+struct SweptSphereArrays {
+    const float* startX;
+    const float* startY;
+    const float* startZ;
+    const float* endX;
+    const float* endY;
+    const float* endZ;
+    const float* radius;
+    size_t count;
+};
+
+// culled[i] = 1 if sphere i stays outside one of the frustum's planes on its whole way, 0 otherwise.
+// Matches Frustum::IntersectsSweep.
+void CullSweptSpheres(const Frustum& frustum, SweptSphereArrays spheres, uint8_t* culled);
+
+// Transforms and colors of instances, gathered for ComposeInstances
+struct InstanceBlock {
+    // A multiple of every vector width
+    static constexpr size_t capacity = 64;
+    
+    float positionX[capacity], positionY[capacity], positionZ[capacity];
+    // Euler angles in degrees, applied around x first, then y, then z
+    float rotationX[capacity], rotationY[capacity], rotationZ[capacity];
+    float scaleX[capacity], scaleY[capacity], scaleZ[capacity];
+    
+    float colorR[capacity], colorG[capacity], colorB[capacity], colorA[capacity];
+    float tintR[capacity], tintG[capacity], tintB[capacity], tintA[capacity];
+};
+
+// Writes the model matrix T * Rz * Ry * Rx * S and color * tint of the first count instances of block
+// to out, in the layout the platform's shaders read. Elements past count are read but not used,
+// so the block must have been initialized once.
+void ComposeInstances(const InstanceBlock& block, size_t count, Instance* out);
+
+// Like ComposeInstances in the compact format, rounding like EncodeCompactInstance
+void ComposeCompactInstances(const InstanceBlock& block, size_t count, CompactInstance* out);
+
+// Calls func(i, j) for each circle i of a that overlaps circle j of b, ordered by j and then by i
+template<typename Func> requires std::invocable<Func&, uint32_t, uint32_t>
+void OverlapCirclePairs(CircleArrays a, CircleArrays b, float epsilon, Func&& func) {
+    // a is tested in blocks so the indices fit on the stack
+    constexpr size_t blockSize = 256;
+    uint32_t indices[blockSize];
+    
+    for (size_t j = 0; j < b.count; j++) {
+        for (size_t begin = 0; begin < a.count; begin += blockSize) {
+            const size_t count = std::min(blockSize, a.count - begin);
+            const CircleArrays block = {a.x + begin, a.y + begin, a.radius + begin, count};
+            const size_t found = OverlapCircles(block, b.x[j], b.y[j], b.radius[j], epsilon, indices);
+            
+            for (size_t k = 0; k < found; k++) {
+                func(static_cast<uint32_t>(begin + indices[k]), static_cast<uint32_t>(j));
+            }
+        }
+    }
+}
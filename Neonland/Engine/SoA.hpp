@@ -0,0 +1,234 @@
+#pragma once
+
+#include <vector>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+
+#include "MathUtils.hpp"
+#include "Component.hpp"
+
+// Reference to three floats, either separate SoA elements or the components of a float3.
+// Reads convert to float3 and writes go through to the referenced floats.
+class Float3Ref {
+public:
+    float& x;
+    float& y;
+    float& z;
+    
+    Float3Ref(float& x, float& y, float& z)
+    : x{x}
+    , y{y}
+    , z{z} { }
+    
+    Float3Ref(float3& v)
+    : Float3Ref(reinterpret_cast<float*>(&v)[0], reinterpret_cast<float*>(&v)[1], reinterpret_cast<float*>(&v)[2]) { }
+    
+    Float3Ref(const Float3Ref& other) = default;
+    
+    operator float3() const { return float3{x, y, z}; }
+    
+    // Assignment writes through instead of rebinding
+    auto operator=(const Float3Ref& rhs) -> Float3Ref& { return *this = static_cast<float3>(rhs); }
+    
+    auto operator=(const float3& rhs) -> Float3Ref& {
+        x = rhs.x;
+        y = rhs.y;
+        z = rhs.z;
+        return *this;
+    }
+    
+    auto operator+=(const float3& rhs) -> Float3Ref& {
+        x += rhs.x;
+        y += rhs.y;
+        z += rhs.z;
+        return *this;
+    }
+    
+    auto operator-=(const float3& rhs) -> Float3Ref& {
+        x -= rhs.x;
+        y -= rhs.y;
+        z -= rhs.z;
+        return *this;
+    }
+    
+    auto operator*=(float rhs) -> Float3Ref& {
+        x *= rhs;
+        y *= rhs;
+        z *= rhs;
+        return *this;
+    }
+    
+    auto operator/=(float rhs) -> Float3Ref& {
+        x /= rhs;
+        y /= rhs;
+        z /= rhs;
+        return *this;
+    }
+};
+
+inline auto operator+(const Float3Ref& lhs, const Float3Ref& rhs) -> float3 { return float3{lhs.x + rhs.x, lhs.y + rhs.y, lhs.z + rhs.z}; }
+inline auto operator+(const Float3Ref& lhs, const float3& rhs) -> float3 { return float3{lhs.x + rhs.x, lhs.y + rhs.y, lhs.z + rhs.z}; }
+inline auto operator+(const float3& lhs, const Float3Ref& rhs) -> float3 { return float3{lhs.x + rhs.x, lhs.y + rhs.y, lhs.z + rhs.z}; }
+
+inline auto operator-(const Float3Ref& lhs, const Float3Ref& rhs) -> float3 { return float3{lhs.x - rhs.x, lhs.y - rhs.y, lhs.z - rhs.z}; }
+inline auto operator-(const Float3Ref& lhs, const float3& rhs) -> float3 { return float3{lhs.x - rhs.x, lhs.y - rhs.y, lhs.z - rhs.z}; }
+inline auto operator-(const float3& lhs, const Float3Ref& rhs) -> float3 { return float3{lhs.x - rhs.x, lhs.y - rhs.y, lhs.z - rhs.z}; }
+
+inline auto operator-(const Float3Ref& v) -> float3 { return float3{-v.x, -v.y, -v.z}; }
+
+inline auto operator*(const Float3Ref& lhs, float rhs) -> float3 { return float3{lhs.x * rhs, lhs.y * rhs, lhs.z * rhs}; }
+inline auto operator*(float lhs, const Float3Ref& rhs) -> float3 { return rhs * lhs; }
+inline auto operator/(const Float3Ref& lhs, float rhs) -> float3 { return float3{lhs.x / rhs, lhs.y / rhs, lhs.z / rhs}; }
+
+// Storage of one field of an SoA component
+template<typename T>
+class SoAColumn {
+public:
+    auto At(size_t index) -> T& { return values[index]; }
+    
+    void PushBack(const T& value) { values.push_back(value); }
+    void PopBack() { values.pop_back(); }
+    void Reserve(size_t count) { values.reserve(count); }
+    void Swap(size_t a, size_t b) { std::swap(values[a], values[b]); }
+    void Move(size_t to, size_t from) { values[to] = std::move(values[from]); }
+    
+    auto Data() -> T* { return values.data(); }
+private:
+    std::vector<T> values;
+};
+
+// float3 fields are split further into x, y and z arrays
+template<>
+class SoAColumn<float3> {
+public:
+    auto At(size_t index) -> Float3Ref { return Float3Ref(x[index], y[index], z[index]); }
+    
+    void PushBack(const float3& value) {
+        x.push_back(value.x);
+        y.push_back(value.y);
+        z.push_back(value.z);
+    }
+    
+    void PopBack() {
+        x.pop_back();
+        y.pop_back();
+        z.pop_back();
+    }
+    
+    void Reserve(size_t count) {
+        x.reserve(count);
+        y.reserve(count);
+        z.reserve(count);
+    }
+    
+    void Swap(size_t a, size_t b) {
+        std::swap(x[a], x[b]);
+        std::swap(y[a], y[b]);
+        std::swap(z[a], z[b]);
+    }
+    
+    void Move(size_t to, size_t from) {
+        x[to] = x[from];
+        y[to] = y[from];
+        z[to] = z[from];
+    }
+    
+    auto X() -> float* { return x.data(); }
+    auto Y() -> float* { return y.data(); }
+    auto Z() -> float* { return z.data(); }
+private:
+    std::vector<float> x, y, z;
+};
+
+// std::vector<bool> cannot hand out bool references
+template<>
+class SoAColumn<bool> {
+public:
+    auto At(size_t index) -> bool& { return values[index].value; }
+    
+    void PushBack(bool value) { values.push_back({value}); }
+    void PopBack() { values.pop_back(); }
+    void Reserve(size_t count) { values.reserve(count); }
+    void Swap(size_t a, size_t b) { std::swap(values[a], values[b]); }
+    void Move(size_t to, size_t from) { values[to] = values[from]; }
+private:
+    struct Bool { bool value; };
+    std::vector<Bool> values;
+};
+
+template<auto Field>
+struct FieldTraits;
+
+template<typename Class, typename T, T Class::* Field>
+struct FieldTraits<Field> {
+    using ComponentType = Class;
+    using Type = T;
+};
+
+template<auto A, auto B>
+inline constexpr bool SameField = false;
+
+template<auto A>
+inline constexpr bool SameField<A, A> = true;
+
+// One column per listed field of a component
+template<auto... Fields>
+class SoAColumns {
+public:
+    template<auto Field>
+    auto At(size_t index) -> decltype(auto) {
+        return Column<Field>().At(index);
+    }
+    
+    template<auto Field>
+    auto Column() -> SoAColumn<typename FieldTraits<Field>::Type>& {
+        return std::get<IndexOf<Field>()>(columns);
+    }
+    
+    template<typename T>
+    void PushBack(const T& component) {
+        (Column<Fields>().PushBack(component.*Fields), ...);
+    }
+    
+    void PopBack() { std::apply([](auto&... column) { (column.PopBack(), ...); }, columns); }
+    void Reserve(size_t count) { std::apply([count](auto&... column) { (column.Reserve(count), ...); }, columns); }
+    void Swap(size_t a, size_t b) { std::apply([a, b](auto&... column) { (column.Swap(a, b), ...); }, columns); }
+    void Move(size_t to, size_t from) { std::apply([to, from](auto&... column) { (column.Move(to, from), ...); }, columns); }
+private:
+    std::tuple<SoAColumn<typename FieldTraits<Fields>::Type>...> columns;
+    
+    template<auto Field>
+    static constexpr auto IndexOf() -> size_t {
+        size_t index = 0;
+        size_t i = 0;
+        ((SameField<Field, Fields> ? (index = i, i++) : i++), ...);
+        return index;
+    }
+};
+
+// Components opt in to SoA storage by specializing SoALayout with the columns to store
+// and a Ref type that exposes the fields of one element under their usual names.
+// Ref must be constructible from the columns and an index, and from the component itself.
+template<typename T>
+struct SoALayout;
+
+template<typename T>
+concept SoAComponent = Component<T> && requires {
+    typename SoALayout<T>::Columns;
+    typename SoALayout<T>::Ref;
+};
+
+template<typename T>
+struct ComponentRefType {
+    using type = T&;
+};
+
+template<SoAComponent T>
+struct ComponentRefType<T> {
+    using type = typename SoALayout<T>::Ref;
+};
+
+// What pools hand out for a component: T& for regular components, the Ref proxy for SoA ones
+template<typename T>
+using ComponentRef = typename ComponentRefType<T>::type;
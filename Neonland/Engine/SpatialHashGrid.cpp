@@ -0,0 +1,81 @@
+#include "SpatialHashGrid.hpp"
+
+#include <cassert>
+#include <bit>
+
+void SpatialHashGrid::Build(std::span<const float2> positions, std::span<const float> radii) {
+    assert(positions.size() == radii.size() && "Every item needs a position and a radius");
+    
+    const auto count = static_cast<uint32_t>(positions.size());
+    
+    if (count > 0) {
+        sortedRadii.assign(radii.begin(), radii.end());
+        auto percentile = sortedRadii.begin() + (count - 1) * 9 / 10;
+        std::nth_element(sortedRadii.begin(), percentile, sortedRadii.end());
+        
+        // Keeps the cell count of queries bounded for point-like items
+        cellSize = std::max(*percentile * 2, 1e-3f);
+    }
+    
+    items.resize(count);
+    entryBuckets.clear();
+    entryItems.clear();
+    
+    // Each item touches about one to four cells, size the table for the typical case
+    const size_t bucketCount = std::bit_ceil(std::max<size_t>(64, count * 2));
+    bucketStarts.assign(bucketCount + 1, 0);
+    
+    for (uint32_t i = 0; i < count; i++) {
+        const float x = positions[i].x;
+        const float y = positions[i].y;
+        const float radius = radii[i];
+        
+        auto& item = items[i];
+        item = Item{x, y, radius, Cells(x - radius, y - radius, x + radius, y + radius)};
+        
+        const size_t firstEntry = entryBuckets.size();
+        
+        const auto cellCount = static_cast<uint64_t>(static_cast<int64_t>(item.cells.maxX) - item.cells.minX + 1)
+                             * static_cast<uint64_t>(static_cast<int64_t>(item.cells.maxY) - item.cells.minY + 1);
+        
+        // Items spanning a large part of the table go in every bucket
+        if (cellCount >= bucketCount / 4) {
+            for (uint32_t bucket = 0; bucket < bucketCount; bucket++) {
+                entryBuckets.push_back(bucket);
+                entryItems.push_back(i);
+                bucketStarts[bucket + 1]++;
+            }
+            continue;
+        }
+        
+        for (int32_t cellY = item.cells.minY; cellY <= item.cells.maxY; cellY++) {
+            for (int32_t cellX = item.cells.minX; cellX <= item.cells.maxX; cellX++) {
+                const auto bucket = Bucket(cellX, cellY);
+                
+                // Two cells of a large item can share a bucket, the item must only be in it once
+                if (std::find(entryBuckets.begin() + firstEntry, entryBuckets.end(), bucket) != entryBuckets.end()) {
+                    continue;
+                }
+                
+                entryBuckets.push_back(bucket);
+                entryItems.push_back(i);
+                bucketStarts[bucket + 1]++;
+            }
+        }
+    }
+    
+    for (size_t b = 0; b < bucketCount; b++) {
+        bucketStarts[b + 1] += bucketStarts[b];
+    }
+    
+    // Counting sort by bucket, bucketStarts[b] is used as the fill cursor and ends as bucket b + 1's start
+    itemIndices.resize(entryItems.size());
+    for (size_t k = 0; k < entryItems.size(); k++) {
+        itemIndices[bucketStarts[entryBuckets[k]]++] = entryItems[k];
+    }
+    
+    for (size_t b = bucketCount; b > 0; b--) {
+        bucketStarts[b] = bucketStarts[b - 1];
+    }
+    bucketStarts[0] = 0;
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <vector>
+#include <span>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <concepts>
+
+#include "MathUtils.hpp"
+
+// Uniform grid over the xy plane for circles, hashed into buckets so it covers any area.
+// Items are identified by their index in the spans passed to Build. Each item is inserted into every
+// cell its bounding square touches, so items larger than a cell are found too.
+class SpatialHashGrid final {
+public:
+    // Rebuilds the grid. The cell size is twice the 90th percentile radius, so typical items
+    // touch at most four cells and a few large ones do not inflate every cell.
+    void Build(std::span<const float2> positions, std::span<const float> radii);
+    
+    auto CellSize() const -> float { return cellSize; }
+    auto Size() const -> size_t { return items.size(); }
+    
+    // Calls func(index) once for each item whose circle overlaps the query circle
+    template<typename Func> requires std::invocable<Func&, uint32_t>
+    void QueryRadius(float2 center, float radius, Func&& func) const;
+    
+    // Calls func(index) once for each item whose circle overlaps the box
+    template<typename Func> requires std::invocable<Func&, uint32_t>
+    void QueryAABB(float2 min, float2 max, Func&& func) const;
+    
+    // Calls func(i, j) with i < j for each pair of items closer than the sum of their radii plus margin,
+    // ordered by i and then in grid order, which is the same for every call with the same items.
+    // The margin lets the caller move items while visiting pairs. Nothing is allocated.
+    template<typename Func> requires std::invocable<Func&, uint32_t, uint32_t>
+    void ForEachNeighbourPair(float margin, Func&& func) const;
+private:
+    struct CellRange {
+        int32_t minX;
+        int32_t minY;
+        int32_t maxX;
+        int32_t maxY;
+    };
+    
+    struct Item {
+        float x;
+        float y;
+        float radius;
+        CellRange cells;
+    };
+    
+    float cellSize = 1;
+    
+    std::vector<Item> items;
+    
+    // Item indices sorted by bucket, bucket b holds itemIndices[bucketStarts[b], bucketStarts[b + 1])
+    std::vector<uint32_t> bucketStarts;
+    std::vector<uint32_t> itemIndices;
+    
+    // Scratch space for Build
+    std::vector<float> sortedRadii;
+    std::vector<uint32_t> entryBuckets;
+    std::vector<uint32_t> entryItems;
+    
+    auto Cells(float minX, float minY, float maxX, float maxY) const -> CellRange;
+    auto Bucket(int32_t cellX, int32_t cellY) const -> uint32_t;
+    
+    // Calls func(index) once per item in the cells of range whose cells also contain (refX, refY)
+    // as their first shared cell, so items spanning several visited cells are reported once.
+    // Queries covering more cells than there are buckets scan every item instead.
+    template<typename Func>
+    void ForEachInCells(const CellRange& range, Func&& func) const;
+};
+
+inline auto SpatialHashGrid::Cells(float minX, float minY, float maxX, float maxY) const -> CellRange {
+    const float inverseCellSize = 1.0f / cellSize;
+    return CellRange{
+        static_cast<int32_t>(std::floor(minX * inverseCellSize)),
+        static_cast<int32_t>(std::floor(minY * inverseCellSize)),
+        static_cast<int32_t>(std::floor(maxX * inverseCellSize)),
+        static_cast<int32_t>(std::floor(maxY * inverseCellSize)),
+    };
+}
+
+inline auto SpatialHashGrid::Bucket(int32_t cellX, int32_t cellY) const -> uint32_t {
+    const uint32_t hash = (static_cast<uint32_t>(cellX) * 73856093u) ^ (static_cast<uint32_t>(cellY) * 19349663u);
+    return hash & static_cast<uint32_t>(bucketStarts.size() - 2);
+}
+
+template<typename Func>
+void SpatialHashGrid::ForEachInCells(const CellRange& range, Func&& func) const {
+    const auto cellCount = static_cast<uint64_t>(static_cast<int64_t>(range.maxX) - range.minX + 1)
+                         * static_cast<uint64_t>(static_cast<int64_t>(range.maxY) - range.minY + 1);
+    
+    if (cellCount >= bucketStarts.size() - 1) {
+        for (uint32_t i = 0; i < items.size(); i++) {
+            func(i);
+        }
+        return;
+    }
+    
+    for (int32_t y = range.minY; y <= range.maxY; y++) {
+        for (int32_t x = range.minX; x <= range.maxX; x++) {
+            const auto bucket = Bucket(x, y);
+            
+            for (auto k = bucketStarts[bucket]; k < bucketStarts[bucket + 1]; k++) {
+                const auto i = itemIndices[k];
+                const auto& cells = items[i].cells;
+                
+                // Hash collisions put items from other cells here, and an item in several visited cells
+                // is only reported from the first one
+                if (std::max(cells.minX, range.minX) == x && std::max(cells.minY, range.minY) == y
+                    && cells.maxX >= x && cells.maxY >= y) {
+                    func(i);
+                }
+            }
+        }
+    }
+}
+
+template<typename Func> requires std::invocable<Func&, uint32_t>
+void SpatialHashGrid::QueryRadius(float2 center, float radius, Func&& func) const {
+    if (items.empty()) {
+        return;
+    }
+    
+    const auto range = Cells(center.x - radius, center.y - radius, center.x + radius, center.y + radius);
+    
+    ForEachInCells(range, [&](uint32_t i) {
+        const auto& item = items[i];
+        
+        const float dx = item.x - center.x;
+        const float dy = item.y - center.y;
+        const float reach = item.radius + radius;
+        
+        if (dx * dx + dy * dy <= reach * reach) {
+            func(i);
+        }
+    });
+}
+
+template<typename Func> requires std::invocable<Func&, uint32_t>
+void SpatialHashGrid::QueryAABB(float2 min, float2 max, Func&& func) const {
+    if (items.empty()) {
+        return;
+    }
+    
+    const auto range = Cells(min.x, min.y, max.x, max.y);
+    
+    ForEachInCells(range, [&](uint32_t i) {
+        const auto& item = items[i];
+        
+        const float dx = item.x - std::clamp(item.x, min.x, max.x);
+        const float dy = item.y - std::clamp(item.y, min.y, max.y);
+        
+        if (dx * dx + dy * dy <= item.radius * item.radius) {
+            func(i);
+        }
+    });
+}
+
+template<typename Func> requires std::invocable<Func&, uint32_t, uint32_t>
+void SpatialHashGrid::ForEachNeighbourPair(float margin, Func&& func) const {
+    for (uint32_t i = 0; i < items.size(); i++) {
+        const auto& a = items[i];
+        const float reachA = a.radius + margin;
+        
+        ForEachInCells(Cells(a.x - reachA, a.y - reachA, a.x + reachA, a.y + reachA), [&](uint32_t j) {
+            if (j <= i) {
+                return;
+            }
+            
+            const auto& b = items[j];
+            
+            const float dx = b.x - a.x;
+            const float dy = b.y - a.y;
+            const float reach = reachA + b.radius;
+            
+            if (dx * dx + dy * dy <= reach * reach) {
+                func(i, j);
+            }
+        });
+    }
+}
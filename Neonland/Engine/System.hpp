@@ -0,0 +1,103 @@
+#pragma once
+
+#include "ComponentMask.hpp"
+#include "Resource.hpp"
+
+template<typename T>
+concept Accessible = Component<T> || Resource<T>;
+
+// Components and resources accessed one way by a system
+struct AccessMask {
+    ComponentMask components;
+    ResourceMask resources;
+    
+    template<Accessible... Args>
+    static auto Of() -> AccessMask {
+        AccessMask mask;
+        (mask.Set<Args>(), ...);
+        return mask;
+    }
+    
+    auto Any() const -> bool { return components.any() || resources.any(); }
+    
+    auto Intersects(const AccessMask& other) const -> bool {
+        return (components & other.components).any() || (resources & other.resources).any();
+    }
+    
+    auto operator|=(const AccessMask& other) -> AccessMask& {
+        components |= other.components;
+        resources |= other.resources;
+        return *this;
+    }
+    
+    auto operator|(const AccessMask& other) const -> AccessMask {
+        auto mask = *this;
+        return mask |= other;
+    }
+private:
+    template<Accessible T>
+    void Set() {
+        if constexpr (Component<T>) {
+            components.set(to_underlying(T::componentType));
+        }
+        else {
+            resources.set(to_underlying(T::resourceType));
+        }
+    }
+};
+
+// Component and resource accesses declared by a system, e.g. System<Read<Transform, Enemy>, Write<Physics, Audio>>.
+// Components declared Read must be accessed without stamping them as changed: through Scene::Read,
+// ReadMembers, ReadColumns or the reads of an update. Systems that make structural changes (creating
+// or destroying entities, adding or removing components, flushing commands) or that create groups
+// must be declared Exclusive. Recording commands is not a structural change.
+template<Accessible... Args> requires (sizeof...(Args) > 0 && AllUnique<Args...>)
+struct Read {
+    static auto Mask() -> AccessMask { return AccessMask::Of<Args...>(); }
+};
+
+template<Accessible... Args> requires (sizeof...(Args) > 0 && AllUnique<Args...>)
+struct Write {
+    static auto Mask() -> AccessMask { return AccessMask::Of<Args...>(); }
+};
+
+struct Exclusive { };
+
+template<typename T>
+inline constexpr bool IsRead = false;
+
+template<Accessible... Args>
+inline constexpr bool IsRead<Read<Args...>> = true;
+
+template<typename T>
+inline constexpr bool IsWrite = false;
+
+template<Accessible... Args>
+inline constexpr bool IsWrite<Write<Args...>> = true;
+
+template<typename... Accesses> requires ((IsRead<Accesses> || IsWrite<Accesses> || std::same_as<Accesses, Exclusive>) && ...)
+struct System {
+    static constexpr bool exclusive = (std::same_as<Accesses, Exclusive> || ...);
+    
+    static auto ReadMask() -> AccessMask {
+        AccessMask mask;
+        ((mask |= MaskIf<Accesses>(IsRead<Accesses>)), ...);
+        return mask;
+    }
+    
+    static auto WriteMask() -> AccessMask {
+        AccessMask mask;
+        ((mask |= MaskIf<Accesses>(IsWrite<Accesses>)), ...);
+        return mask;
+    }
+private:
+    template<typename Access>
+    static auto MaskIf(bool condition) -> AccessMask {
+        if constexpr (std::same_as<Access, Exclusive>) {
+            return {};
+        }
+        else {
+            return condition ? Access::Mask() : AccessMask{};
+        }
+    }
+};
@@ -0,0 +1,172 @@
+#include "SystemScheduler.hpp"
+#include "CommandBuffer.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+
+namespace {
+    auto MaskToString(const AccessMask& mask) -> std::string {
+        std::string names;
+        for (size_t i = 0; i < COMPONENT_COUNT; i++) {
+            if (mask.components[i]) {
+                names += names.empty() ? "" : ", ";
+                names += ComponentTypeName(static_cast<ComponentType>(i));
+            }
+        }
+        for (size_t i = 0; i < RESOURCE_COUNT; i++) {
+            if (mask.resources[i]) {
+                names += names.empty() ? "" : ", ";
+                names += ResourceTypeName(static_cast<ResourceType>(i));
+            }
+        }
+        return names;
+    }
+}
+
+void SystemScheduler::Run() {
+    if (systems.empty()) {
+        return;
+    }
+    
+    std::vector<size_t> roots;
+    
+    for (size_t i = 0; i < systems.size(); i++) {
+        remainingDependencies[i].store(systems[i].dependencies.size(), std::memory_order_relaxed);
+        
+        if (systems[i].dependencies.empty()) {
+            roots.push_back(i);
+        }
+    }
+    
+    finishedCount.store(0, std::memory_order_relaxed);
+    
+    auto& threadPool = ThreadPool::GetInstance();
+    
+    for (size_t i = 1; i < roots.size(); i++) {
+        threadPool.SubmitJob([this, root = roots[i]] { RunFrom(root); });
+    }
+    
+    RunFrom(roots[0]);
+    
+    // Help with the pool's jobs, including the parallel updates of running systems, until done
+    while (finishedCount.load(std::memory_order_acquire) < systems.size()) {
+        if (!threadPool.RunPendingJob()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+auto SystemScheduler::Dump() const -> std::string {
+    std::ostringstream out;
+    out << systems.size() << " systems, critical path " << CriticalPathLength() << "\n";
+    
+    for (auto& system : systems) {
+        out << std::setw(3) << system.depth << "  " << std::left << std::setw(20) << system.name << std::right;
+        
+        if (system.exclusive) {
+            out << " exclusive;";
+        }
+        if (system.readMask.Any()) {
+            out << " reads " << MaskToString(system.readMask) << ";";
+        }
+        if (system.writeMask.Any()) {
+            out << " writes " << MaskToString(system.writeMask) << ";";
+        }
+        
+        if (!system.dependencies.empty()) {
+            out << " after";
+            for (size_t i = 0; i < system.dependencies.size(); i++) {
+                out << (i == 0 ? " " : ", ") << systems[system.dependencies[i]].name;
+            }
+        }
+        
+        out << "\n";
+    }
+    
+    return out.str();
+}
+
+auto SystemScheduler::CriticalPathLength() const -> size_t {
+    size_t length = 0;
+    for (auto& system : systems) {
+        length = std::max(length, system.depth + 1);
+    }
+    return length;
+}
+
+auto SystemScheduler::SystemCount() const -> size_t {
+    return systems.size();
+}
+
+void SystemScheduler::AddNode(Node node) {
+    const size_t index = systems.size();
+    
+    node.ancestors.assign(index, false);
+    node.depth = 0;
+    
+    // Latest conflicting systems first, so a conflict already implied by a kept dependency is skipped
+    for (size_t i = index; i-- > 0;) {
+        if (!Conflicts(systems[i], node) || node.ancestors[i]) {
+            continue;
+        }
+        
+        node.dependencies.push_back(i);
+        node.ancestors[i] = true;
+        node.depth = std::max(node.depth, systems[i].depth + 1);
+        
+        for (size_t j = 0; j < i; j++) {
+            if (systems[i].ancestors[j]) {
+                node.ancestors[j] = true;
+            }
+        }
+    }
+    
+    std::reverse(node.dependencies.begin(), node.dependencies.end());
+    
+    for (auto dependency : node.dependencies) {
+        systems[dependency].dependents.push_back(index);
+    }
+    
+    systems.push_back(std::move(node));
+    remainingDependencies = std::make_unique<std::atomic<size_t>[]>(systems.size());
+}
+
+auto SystemScheduler::Conflicts(const Node& a, const Node& b) -> bool {
+    return a.exclusive || b.exclusive
+        || a.writeMask.Intersects(b.readMask | b.writeMask)
+        || b.writeMask.Intersects(a.readMask);
+}
+
+void SystemScheduler::RunFrom(size_t i) {
+    auto& threadPool = ThreadPool::GetInstance();
+    
+    while (true) {
+        {
+            CommandBufferScope scope{i + 1, 0};
+            systems[i].run();
+        }
+        
+        constexpr size_t none = static_cast<size_t>(-1);
+        size_t next = none;
+        
+        for (auto dependent : systems[i].dependents) {
+            if (remainingDependencies[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                if (next == none) {
+                    next = dependent;
+                }
+                else {
+                    threadPool.SubmitJob([this, dependent] { RunFrom(dependent); });
+                }
+            }
+        }
+        
+        finishedCount.fetch_add(1, std::memory_order_release);
+        
+        if (next == none) {
+            return;
+        }
+        
+        i = next;
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <functional>
+#include <atomic>
+#include <memory>
+
+#include "System.hpp"
+#include "ThreadPool.hpp"
+
+// Runs a fixed set of systems each tick. A system depends on the earlier registered systems
+// whose accesses conflict with its own (one writes a component or resource the other reads or
+// writes, or either is Exclusive), and systems whose dependencies have finished run concurrently on the ThreadPool.
+// The result matches running the systems one by one in registration order as long as
+// the declared accesses cover everything the systems touch. System i records its commands
+// into command buffer set i + 1, see Scene::ReserveCommandBuffers.
+class SystemScheduler {
+public:
+    template<typename SystemType>
+    void Add(std::string name, std::function<void()> run);
+    
+    // Runs every system once and returns when all of them have finished.
+    // Must not be called from inside a system.
+    void Run();
+    
+    // One line per system with its depth in the dependency graph, accesses and direct dependencies
+    auto Dump() const -> std::string;
+    
+    // Number of systems on the longest dependency chain
+    auto CriticalPathLength() const -> size_t;
+    
+    auto SystemCount() const -> size_t;
+private:
+    struct Node {
+        std::string name;
+        std::function<void()> run;
+        
+        AccessMask readMask;
+        AccessMask writeMask;
+        bool exclusive;
+        
+        // Only the dependencies not already implied by other dependencies
+        std::vector<size_t> dependencies;
+        std::vector<size_t> dependents;
+        
+        // Earlier systems this one transitively depends on
+        std::vector<bool> ancestors;
+        
+        size_t depth;
+    };
+    
+    std::vector<Node> systems;
+    
+    std::unique_ptr<std::atomic<size_t>[]> remainingDependencies;
+    std::atomic<size_t> finishedCount;
+    
+    void AddNode(Node node);
+    
+    static auto Conflicts(const Node& a, const Node& b) -> bool;
+    
+    // Runs system i, then keeps running one of the dependents it made ready on this thread
+    // and submits the rest to the pool
+    void RunFrom(size_t i);
+};
+
+template<typename SystemType>
+void SystemScheduler::Add(std::string name, std::function<void()> run) {
+    Node node;
+    node.name = std::move(name);
+    node.run = std::move(run);
+    node.readMask = SystemType::ReadMask();
+    node.writeMask = SystemType::WriteMask();
+    node.exclusive = SystemType::exclusive;
+    
+    AddNode(std::move(node));
+}
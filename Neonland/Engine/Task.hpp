@@ -0,0 +1,353 @@
+#pragma once
+
+#include <coroutine>
+#include <atomic>
+#include <exception>
+#include <optional>
+#include <variant>
+#include <tuple>
+#include <vector>
+#include <utility>
+#include <type_traits>
+#include <cassert>
+
+#include "ThreadPool.hpp"
+#include "FrameAllocator.hpp"
+
+// Lazily started coroutine returning T. A task starts when it is awaited, passed to WhenAll,
+// Spawn or SyncWait, and resumes its awaiter when it finishes. While suspended it occupies no thread.
+//
+//     auto LoadMesh(std::string path) -> Task<Mesh> {
+//         co_await ScheduleOn(ThreadPool::GetInstance(), JobPriority::Background);
+//         auto data = ReadFile(path);
+//         co_await ScheduleOn(ThreadPool::GetInstance());
+//         co_return ParseMesh(data);
+//     }
+template<typename T = void>
+class Task;
+
+namespace TaskDetail {
+    struct Latch {
+        std::atomic<size_t> count;
+        std::coroutine_handle<> continuation;
+        
+        // Returns the continuation for the last arrival. The latch is not touched after the count drops:
+        // once it reaches 0 the waiter may return and destroy the latch.
+        auto Arrive() noexcept -> std::coroutine_handle<> {
+            const auto next = continuation;
+            
+            if (count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                return next;
+            }
+            return std::noop_coroutine();
+        }
+    };
+    
+    struct PromiseBase {
+        std::coroutine_handle<> continuation;
+        // Set instead of continuation when started by WhenAll or SyncWait
+        Latch* latch = nullptr;
+        bool detached = false;
+        std::exception_ptr exception;
+        
+        ThreadPool::ResumeJob startJob;
+        
+        static auto operator new(size_t size) -> void* {
+            return FrameAllocator::Allocate(size);
+        }
+        
+        static void operator delete(void* ptr, size_t size) {
+            FrameAllocator::Deallocate(ptr, size);
+        }
+        
+        struct FinalAwaiter {
+            auto await_ready() const noexcept -> bool { return false; }
+            
+            template<typename Promise>
+            auto await_suspend(std::coroutine_handle<Promise> handle) const noexcept -> std::coroutine_handle<> {
+                auto& promise = handle.promise();
+                
+                if (promise.detached) {
+                    assert(!promise.exception && "Spawned task threw");
+                    handle.destroy();
+                    return std::noop_coroutine();
+                }
+                // The last arrival may let the waiter destroy this coroutine, nothing is touched after it
+                if (promise.latch) {
+                    return promise.latch->Arrive();
+                }
+                return promise.continuation ? promise.continuation : std::noop_coroutine();
+            }
+            
+            void await_resume() const noexcept { }
+        };
+        
+        auto initial_suspend() const noexcept -> std::suspend_always { return {}; }
+        auto final_suspend() const noexcept -> FinalAwaiter { return {}; }
+        
+        void unhandled_exception() noexcept {
+            exception = std::current_exception();
+        }
+    };
+    
+    template<typename T>
+    struct Promise : PromiseBase {
+        std::optional<T> value;
+        
+        auto get_return_object() -> Task<T>;
+        
+        template<typename U> requires std::convertible_to<U&&, T>
+        void return_value(U&& result) {
+            value.emplace(std::forward<U>(result));
+        }
+        
+        auto TakeResult() -> T {
+            if (exception) {
+                std::rethrow_exception(exception);
+            }
+            return std::move(*value);
+        }
+    };
+    
+    template<>
+    struct Promise<void> : PromiseBase {
+        auto get_return_object() -> Task<void>;
+        
+        void return_void() const noexcept { }
+        
+        void TakeResult() const {
+            if (exception) {
+                std::rethrow_exception(exception);
+            }
+        }
+    };
+    
+    // What WhenAll stores for a task's result
+    template<typename T>
+    using Result = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+    
+    struct Access;
+}
+
+template<typename T>
+class [[nodiscard]] Task final {
+public:
+    using promise_type = TaskDetail::Promise<T>;
+    
+    Task() = default;
+    
+    Task(Task&& other) noexcept
+    : handle{std::exchange(other.handle, nullptr)} { }
+    
+    auto operator=(Task&& other) noexcept -> Task& {
+        if (this != &other) {
+            Reset();
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+    
+    ~Task() {
+        Reset();
+    }
+    
+    auto IsValid() const -> bool { return static_cast<bool>(handle); }
+    
+    auto operator co_await() && noexcept {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> handle;
+            
+            auto await_ready() const noexcept -> bool { return handle.done(); }
+            
+            auto await_suspend(std::coroutine_handle<> awaiting) const noexcept -> std::coroutine_handle<> {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+            
+            auto await_resume() const -> T {
+                return handle.promise().TakeResult();
+            }
+        };
+        
+        assert(handle && "Awaiting an empty task");
+        return Awaiter{handle};
+    }
+private:
+    friend promise_type;
+    friend TaskDetail::Access;
+    
+    std::coroutine_handle<promise_type> handle;
+    
+    explicit Task(std::coroutine_handle<promise_type> handle)
+    : handle{handle} { }
+    
+    void Reset() {
+        if (handle) {
+            handle.destroy();
+            handle = nullptr;
+        }
+    }
+};
+
+template<typename T>
+auto TaskDetail::Promise<T>::get_return_object() -> Task<T> {
+    return Task<T>(std::coroutine_handle<Promise>::from_promise(*this));
+}
+
+inline auto TaskDetail::Promise<void>::get_return_object() -> Task<void> {
+    return Task<void>(std::coroutine_handle<Promise>::from_promise(*this));
+}
+
+namespace TaskDetail {
+    struct Access {
+        // Queues the task on the pool, or runs it until it first suspends if the lane has no threads
+        template<typename Promise>
+        static void Start(std::coroutine_handle<Promise> handle, ThreadPool& pool, JobPriority priority) {
+            if (!pool.QueueResume(handle.promise().startJob, handle, priority)) {
+                handle.resume();
+            }
+        }
+        
+        template<typename T>
+        static void StartCounted(Task<T>& task, ThreadPool& pool, Latch& latch) {
+            task.handle.promise().latch = &latch;
+            Start(task.handle, pool, JobPriority::High);
+        }
+        
+        template<typename T>
+        static auto TakeResult(Task<T>& task) -> Result<T> {
+            if constexpr (std::is_void_v<T>) {
+                task.handle.promise().TakeResult();
+                return {};
+            }
+            else {
+                return task.handle.promise().TakeResult();
+            }
+        }
+        
+        // The task destroys itself when it finishes
+        static void Spawn(Task<>& task, ThreadPool& pool, JobPriority priority) {
+            assert(task.handle && "Spawning an empty task");
+            
+            auto handle = std::exchange(task.handle, nullptr);
+            handle.promise().detached = true;
+            Start(handle, pool, priority);
+        }
+    };
+    
+    // Starts every task on the pool and resumes the awaiting coroutine once all have finished
+    template<typename StartAll>
+    struct WhenAllAwaiter {
+        size_t taskCount;
+        StartAll startAll;
+        Latch latch;
+        
+        auto await_ready() const noexcept -> bool { return taskCount == 0; }
+        
+        auto await_suspend(std::coroutine_handle<> awaiting) -> bool {
+            // One extra count so the tasks cannot resume the awaiting coroutine before it has suspended
+            latch.count.store(taskCount + 1, std::memory_order_relaxed);
+            latch.continuation = awaiting;
+            
+            startAll(latch);
+            
+            return latch.count.fetch_sub(1, std::memory_order_acq_rel) > 1;
+        }
+        
+        void await_resume() const noexcept { }
+    };
+    
+    template<typename StartAll>
+    auto MakeWhenAllAwaiter(size_t taskCount, StartAll startAll) -> WhenAllAwaiter<StartAll> {
+        return WhenAllAwaiter<StartAll>{taskCount, std::move(startAll), {}};
+    }
+}
+
+// Resumes the awaiting coroutine as a job on pool. Resumes it immediately if the lane has no threads.
+class ScheduleAwaiter {
+public:
+    ScheduleAwaiter(ThreadPool& pool, JobPriority priority)
+    : pool{pool}
+    , priority{priority} { }
+    
+    auto await_ready() const noexcept -> bool { return false; }
+    
+    auto await_suspend(std::coroutine_handle<> awaiting) -> bool {
+        return pool.QueueResume(job, awaiting, priority);
+    }
+    
+    void await_resume() const noexcept { }
+private:
+    ThreadPool& pool;
+    JobPriority priority;
+    ThreadPool::ResumeJob job;
+};
+
+inline auto ScheduleOn(ThreadPool& pool, JobPriority priority = JobPriority::High) -> ScheduleAwaiter {
+    return ScheduleAwaiter(pool, priority);
+}
+
+// Runs the tasks concurrently on the pool's workers. Void results are std::monostate.
+// If a task threw, its exception is rethrown once all have finished.
+template<typename... Ts>
+auto WhenAll(Task<Ts>... tasks) -> Task<std::tuple<TaskDetail::Result<Ts>...>> {
+    auto& pool = ThreadPool::GetInstance();
+    
+    co_await TaskDetail::MakeWhenAllAwaiter(sizeof...(Ts), [&](TaskDetail::Latch& latch) {
+        (TaskDetail::Access::StartCounted(tasks, pool, latch), ...);
+    });
+    
+    co_return std::tuple<TaskDetail::Result<Ts>...>{TaskDetail::Access::TakeResult(tasks)...};
+}
+
+template<typename T>
+auto WhenAll(std::vector<Task<T>> tasks) -> Task<std::vector<TaskDetail::Result<T>>> {
+    auto& pool = ThreadPool::GetInstance();
+    
+    co_await TaskDetail::MakeWhenAllAwaiter(tasks.size(), [&](TaskDetail::Latch& latch) {
+        for (auto& task : tasks) {
+            TaskDetail::Access::StartCounted(task, pool, latch);
+        }
+    });
+    
+    std::vector<TaskDetail::Result<T>> results;
+    results.reserve(tasks.size());
+    
+    for (auto& task : tasks) {
+        results.push_back(TaskDetail::Access::TakeResult(task));
+    }
+    
+    co_return results;
+}
+
+// Starts task on pool without waiting for it. The task frees itself when it finishes and must not throw.
+inline void Spawn(ThreadPool& pool, Task<> task, JobPriority priority = JobPriority::High) {
+    TaskDetail::Access::Spawn(task, pool, priority);
+}
+
+// Runs task from code that is not a coroutine and returns its result.
+// The calling thread runs queued jobs while waiting, like ThreadPool::Wait.
+template<typename T>
+auto SyncWait(Task<T> task) -> T {
+    auto& pool = ThreadPool::GetInstance();
+    
+    TaskDetail::Latch latch;
+    latch.count.store(1, std::memory_order_relaxed);
+    latch.continuation = std::noop_coroutine();
+    
+    TaskDetail::Access::StartCounted(task, pool, latch);
+    
+    // The count reaching 0 is the finishing thread's last access to the latch and the task
+    while (latch.count.load(std::memory_order_acquire) > 0) {
+        if (!pool.RunPendingJob()) {
+            std::this_thread::yield();
+        }
+    }
+    
+    if constexpr (std::is_void_v<T>) {
+        TaskDetail::Access::TakeResult(task);
+    }
+    else {
+        return TaskDetail::Access::TakeResult(task);
+    }
+}
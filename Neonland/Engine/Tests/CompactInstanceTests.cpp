@@ -0,0 +1,249 @@
+// Standalone checks for CompactInstance.hpp and ComposeCompactInstances, built from the repository root with
+//     clang++ -std=c++20 -O2 -INeonland/Engine Neonland/Engine/Tests/CompactInstanceTests.cpp
+//         Neonland/Engine/CompactInstance.cpp Neonland/Engine/SimdKernels.cpp Neonland/Engine/MathUtils.cpp
+//         Neonland/Engine/Frustum.cpp -o CompactInstanceTests
+// Exits with 1 and names the failed check if one fails.
+
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <algorithm>
+
+#include "../CompactInstance.hpp"
+
+namespace {
+    int failures = 0;
+    
+    void Check(bool condition, const char* what) {
+        if (!condition) {
+            std::printf("FAILED: %s\n", what);
+            failures++;
+        }
+    }
+    
+    // Scales the half conversion must get right: both signs of zero, subnormals of both formats,
+    // the rounding boundaries around the largest half and values that do not fit
+    constexpr float specialScales[] = {
+        0.0f, -0.0f, 1.0f, -1.0f, 0.5f,
+        std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+        std::numeric_limits<float>::quiet_NaN(), -std::numeric_limits<float>::quiet_NaN(),
+        std::numeric_limits<float>::denorm_min(), -std::numeric_limits<float>::denorm_min(),
+        std::numeric_limits<float>::min(), 5.9604645e-8f, 2.9802322e-8f, 2.9802326e-8f, 8.940697e-8f,
+        6.097555e-5f, 6.1035156e-5f, 65504.0f, 65519.996f, 65520.0f, 65536.0f, -70000.0f, 1e30f,
+    };
+    
+    // Angles away from [0, 360) and exactly on the wrap
+    constexpr float specialAngles[] = {
+        0.0f, -0.0f, 360.0f, -360.0f, 720.0f, 180.0f, -180.0f, 359.99725f, -0.0027466f, 0.0027466f,
+        -90.0f, 450.0f, -1e6f, 1e6f, 12345.678f, -12345.678f,
+    };
+    
+    void FillBlock(InstanceBlock& block, std::mt19937& random, int round) {
+        std::uniform_real_distribution<float> unit(-1, 1);
+        std::uniform_int_distribution<uint32_t> bits;
+        
+        for (size_t i = 0; i < InstanceBlock::capacity; i++) {
+            block.positionX[i] = unit(random) * 50;
+            block.positionY[i] = unit(random) * 50;
+            block.positionZ[i] = unit(random);
+            
+            // Every few instances take the special values, the others any float bits
+            const size_t pick = bits(random);
+            const bool special = (i + round) % 3 == 0;
+            block.rotationX[i] = special ? specialAngles[pick % std::size(specialAngles)] : unit(random) * 3600;
+            block.rotationY[i] = unit(random) * 360;
+            block.rotationZ[i] = special ? specialAngles[(pick >> 8) % std::size(specialAngles)] : unit(random) * 1e5f;
+            block.scaleX[i] = special ? specialScales[(pick >> 16) % std::size(specialScales)] : std::bit_cast<float>(bits(random));
+            block.scaleY[i] = unit(random) * 70000;
+            block.scaleZ[i] = std::ldexp(unit(random), -static_cast<int>(pick % 30));
+            
+            // Colors and tints outside [0, 1] are clamped after multiplying
+            block.colorR[i] = unit(random) * 1.5f;
+            block.colorG[i] = unit(random);
+            block.colorB[i] = static_cast<float>(bits(random) % 256) / 255;
+            block.colorA[i] = 1;
+            block.tintR[i] = unit(random);
+            block.tintG[i] = 1;
+            block.tintB[i] = 1;
+            block.tintA[i] = static_cast<float>(bits(random) % 511) / 510;
+        }
+    }
+    
+    auto Encode(const InstanceBlock& block, size_t i) -> CompactInstance {
+        return EncodeCompactInstance({block.positionX[i], block.positionY[i], block.positionZ[i]},
+                                     {block.rotationX[i], block.rotationY[i], block.rotationZ[i]},
+                                     {block.scaleX[i], block.scaleY[i], block.scaleZ[i]},
+                                     {block.colorR[i] * block.tintR[i],
+                                      block.colorG[i] * block.tintG[i],
+                                      block.colorB[i] * block.tintB[i],
+                                      block.colorA[i] * block.tintA[i]});
+    }
+    
+    // The kernel gives the reference encoder's bits for every count, including the tails the vector
+    // paths handle separately, and writes nothing past count
+    void ComposeMatchesEncode() {
+        std::mt19937 random(3);
+        InstanceBlock block = {};
+        
+        for (int round = 0; round < 20000; round++) {
+            FillBlock(block, random, round);
+            
+            const size_t count = 1 + round % InstanceBlock::capacity;
+            CompactInstance out[InstanceBlock::capacity + 1];
+            std::memset(out, 0xa5, sizeof(out));
+            
+            ComposeCompactInstances(block, count, out);
+            
+            for (size_t i = 0; i < count; i++) {
+                const CompactInstance expected = Encode(block, i);
+                if (std::memcmp(&expected, &out[i], sizeof(CompactInstance)) != 0) {
+                    Check(false, "ComposeCompactInstances matches EncodeCompactInstance bit for bit");
+                    return;
+                }
+            }
+            
+            CompactInstance untouched;
+            std::memset(&untouched, 0xa5, sizeof(untouched));
+            for (size_t i = count; i < std::size(out); i++) {
+                if (std::memcmp(&untouched, &out[i], sizeof(CompactInstance)) != 0) {
+                    Check(false, "ComposeCompactInstances writes only count instances");
+                    return;
+                }
+            }
+        }
+    }
+    
+    // Every float on and next to the points where the half rounding changes, through the kernel
+    void ComposeRoundsScalesLikeFloatToHalf() {
+        InstanceBlock block = {};
+        
+        for (uint32_t half = 0; half < 0x7c00; half++) {
+            const float low = HalfToFloat(static_cast<uint16_t>(half));
+            const float high = HalfToFloat(static_cast<uint16_t>(half + 1));
+            const float middle = (low + high) / 2;
+            const float values[] = {low, middle, std::nextafter(middle, 0.0f), std::nextafter(middle, 1e9f), -middle};
+            
+            for (float value : values) {
+                std::fill(std::begin(block.scaleX), std::end(block.scaleX), value);
+                
+                CompactInstance out[8];
+                ComposeCompactInstances(block, std::size(out), out);
+                
+                if (out[0].scale[0] != FloatToHalf(value) || out[7].scale[0] != FloatToHalf(value)) {
+                    Check(false, "ComposeCompactInstances rounds scales like FloatToHalf");
+                    return;
+                }
+            }
+        }
+    }
+    
+    void HalfConversions() {
+        bool roundTrips = true;
+        for (uint32_t half = 0; half < 0x10000; half++) {
+            const float value = HalfToFloat(static_cast<uint16_t>(half));
+            // NaNs keep their sign and stay NaN, the payload is not kept
+            if (std::isnan(value) ? (FloatToHalf(value) & 0xfc00) != (half & 0xfc00) : FloatToHalf(value) != half) {
+                roundTrips = false;
+            }
+        }
+        Check(roundTrips, "FloatToHalf inverts HalfToFloat");
+        
+        Check(FloatToHalf(65519.996f) == 0x7bff, "65519.996 rounds down to the largest half");
+        Check(FloatToHalf(65520.0f) == 0x7c00, "65520 rounds up to infinity");
+        Check(FloatToHalf(-1e30f) == 0xfc00, "Large negative values become negative infinity");
+        Check(FloatToHalf(2.9802322e-8f) == 0x0000, "Half the smallest subnormal rounds to even, zero");
+        Check(FloatToHalf(8.940697e-8f) == 0x0002, "One and a half subnormals round to even, two");
+        Check(FloatToHalf(-0.0f) == 0x8000, "Negative zero keeps its sign");
+        Check((FloatToHalf(std::numeric_limits<float>::quiet_NaN()) & 0x7fff) > 0x7c00, "NaN stays NaN");
+    }
+    
+    // Decoding composes the same matrices and colors as the original values,
+    // up to the quantization of the angles, scales and colors
+    void DecodeMatchesCompose() {
+        std::mt19937 random(7);
+        std::uniform_real_distribution<float> unit(-1, 1);
+        std::uniform_real_distribution<float> positive(0, 1);
+        
+        constexpr size_t count = 1000;
+        static InstanceBlock blocks[(count + InstanceBlock::capacity - 1) / InstanceBlock::capacity];
+        CompactInstance compact[count];
+        Instance expected[count];
+        Instance decoded[count];
+        
+        float maxScale = 0;
+        
+        for (size_t i = 0; i < count; i++) {
+            InstanceBlock& block = blocks[i / InstanceBlock::capacity];
+            const size_t j = i % InstanceBlock::capacity;
+            
+            block.positionX[j] = unit(random) * 50;
+            block.positionY[j] = unit(random) * 50;
+            block.positionZ[j] = unit(random);
+            block.rotationX[j] = unit(random) * 720;
+            block.rotationY[j] = unit(random) * 720;
+            block.rotationZ[j] = unit(random) * 720;
+            block.scaleX[j] = 0.1f + positive(random) * 10;
+            block.scaleY[j] = 0.1f + positive(random) * 10;
+            block.scaleZ[j] = 0.1f + positive(random) * 10;
+            block.colorR[j] = positive(random);
+            block.colorG[j] = positive(random);
+            block.colorB[j] = positive(random);
+            block.colorA[j] = positive(random);
+            block.tintR[j] = 1;
+            block.tintG[j] = 1;
+            block.tintB[j] = 1;
+            block.tintA[j] = 1;
+            
+            maxScale = std::max({maxScale, block.scaleX[j], block.scaleY[j], block.scaleZ[j]});
+            compact[i] = Encode(block, j);
+        }
+        
+        for (size_t begin = 0; begin < count; begin += InstanceBlock::capacity) {
+            ComposeInstances(blocks[begin / InstanceBlock::capacity], std::min(InstanceBlock::capacity, count - begin), expected + begin);
+        }
+        
+        DecodeCompactInstances(compact, count, decoded);
+        
+        // Angles are within half a step of 360 / 65536 degrees and scales within 2^-11 relative,
+        // colors within half of 1 / 255
+        const float matrixTolerance = 1e-3f * maxScale;
+        const float colorTolerance = 0.5f / 255 + 1e-6f;
+        
+        constexpr size_t matrixFloats = sizeof(Instance::transform) / sizeof(float);
+        constexpr size_t instanceFloats = sizeof(Instance) / sizeof(float);
+        
+        bool matricesMatch = true;
+        bool colorsMatch = true;
+        
+        for (size_t i = 0; i < count; i++) {
+            const auto* a = reinterpret_cast<const float*>(&expected[i]);
+            const auto* b = reinterpret_cast<const float*>(&decoded[i]);
+            
+            // The translation is stored as is, but goes through the same arithmetic
+            for (size_t k = 0; k < matrixFloats; k++) {
+                matricesMatch &= std::fabs(a[k] - b[k]) <= matrixTolerance + 1e-6f * std::fabs(a[k]);
+            }
+            for (size_t k = matrixFloats; k < instanceFloats; k++) {
+                colorsMatch &= std::fabs(a[k] - b[k]) <= colorTolerance;
+            }
+        }
+        
+        Check(matricesMatch, "DecodeCompactInstances matches ComposeInstances within the quantization");
+        Check(colorsMatch, "Decoded colors are within half a step of the originals");
+    }
+}
+
+int main() {
+    std::printf("Kernels: %s\n", SimdKernelTarget());
+    
+    ComposeMatchesEncode();
+    ComposeRoundsScalesLikeFloatToHalf();
+    HalfConversions();
+    DecodeMatchesCompose();
+    
+    std::printf(failures == 0 ? "CompactInstance tests passed\n" : "%d CompactInstance tests failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+// Standalone checks for ComponentObservers.hpp, built from the repository root with
+//     clang++ -std=c++20 -O2 -INeonland/Engine Neonland/Engine/Tests/ComponentObserversTests.cpp
+//         -o ComponentObserversTests
+// Exits with 1 and names the failed check if one fails.
+
+#include <cstdio>
+#include <vector>
+
+#include "../ComponentObservers.hpp"
+
+namespace {
+    int failures = 0;
+    
+    void Check(bool condition, const char* what) {
+        if (!condition) {
+            std::printf("FAILED: %s\n", what);
+            failures++;
+        }
+    }
+    
+    constexpr auto observedType = static_cast<ComponentType>(0);
+    
+    // Records the masks the observers see, as a scene does when it changes them
+    struct FakeScene {
+        std::vector<Entity> alive;
+        std::vector<ComponentMask> masks;
+        ComponentObservers observers;
+        
+        auto Create(Entity::Id id, Entity::Version version) -> Entity {
+            if (id >= alive.size()) {
+                alive.resize(id + 1, Entity{Entity::NULL_ID, 0});
+                masks.resize(id + 1);
+            }
+            alive[id] = Entity{id, version};
+            return alive[id];
+        }
+        
+        void Add(Entity entity) {
+            masks[entity.id].set(0);
+            observers.RecordAdd(entity, masks[entity.id]);
+        }
+        
+        void Remove(Entity entity) {
+            auto removed = masks[entity.id];
+            masks[entity.id].reset();
+            observers.RecordRemove(entity, removed);
+        }
+        
+        void Destroy(Entity entity) {
+            Remove(entity);
+            alive[entity.id] = Entity{Entity::NULL_ID, 0};
+        }
+        
+        auto IsAlive(Entity entity) const -> bool {
+            return entity.id < alive.size() && alive[entity.id] == entity;
+        }
+        
+        auto GetMask(Entity entity) const -> ComponentMask {
+            return masks[entity.id];
+        }
+    };
+    
+    struct Delivered {
+        std::vector<Entity> added;
+        std::vector<Entity> removed;
+    };
+    
+    void Observe(FakeScene& scene, Delivered& delivered) {
+        scene.observers.OnAdd(observedType, [&delivered](std::span<const Entity> entities) {
+            delivered.added.insert(delivered.added.end(), entities.begin(), entities.end());
+        });
+        scene.observers.OnRemove(observedType, [&delivered](std::span<const Entity> entities) {
+            delivered.removed.insert(delivered.removed.end(), entities.begin(), entities.end());
+        });
+    }
+    
+    void Netting() {
+        FakeScene scene;
+        Delivered delivered;
+        Observe(scene, delivered);
+        
+        auto a = scene.Create(0, 0);
+        auto b = scene.Create(1, 0);
+        scene.Add(a);
+        scene.Add(b);
+        scene.observers.Notify(scene);
+        Check(delivered.added == std::vector<Entity>{a, b}, "Additions are delivered in record order");
+        
+        delivered = {};
+        scene.Remove(a);
+        scene.Add(a);
+        scene.Remove(a);
+        scene.Add(a);
+        scene.observers.Notify(scene);
+        Check(delivered.added.empty() && delivered.removed.empty(), "Remove and add again is not delivered");
+        
+        delivered = {};
+        auto c = scene.Create(2, 0);
+        scene.Add(c);
+        scene.Remove(c);
+        scene.observers.Notify(scene);
+        Check(delivered.added.empty() && delivered.removed.empty(), "Add and remove again is not delivered");
+        
+        delivered = {};
+        scene.Add(c);
+        scene.Remove(c);
+        scene.Add(c);
+        scene.observers.Notify(scene);
+        Check(delivered.added == std::vector<Entity>{c} && delivered.removed.empty(), "Repeated additions are delivered once");
+        
+        delivered = {};
+        scene.Remove(b);
+        scene.Add(b);
+        scene.Remove(b);
+        scene.observers.Notify(scene);
+        Check(delivered.removed == std::vector<Entity>{b} && delivered.added.empty(), "Repeated removals are delivered once");
+    }
+    
+    void ReusedIds() {
+        FakeScene scene;
+        Delivered delivered;
+        Observe(scene, delivered);
+        
+        auto a = scene.Create(0, 0);
+        scene.Add(a);
+        scene.observers.Notify(scene);
+        
+        // The id is released and reused twice, the middle entity lives and dies within the batch
+        delivered = {};
+        scene.Destroy(a);
+        auto b = scene.Create(0, 1);
+        scene.Add(b);
+        scene.Destroy(b);
+        auto c = scene.Create(0, 2);
+        scene.Add(c);
+        scene.observers.Notify(scene);
+        Check(delivered.removed == std::vector<Entity>{a}, "The destroyed entity is removed");
+        Check(delivered.added == std::vector<Entity>{c}, "Only the entity now holding the id is added");
+    }
+    
+    void RecordingDuringDelivery() {
+        FakeScene scene;
+        Delivered delivered;
+        Observe(scene, delivered);
+        
+        auto a = scene.Create(0, 0);
+        auto b = scene.Create(1, 0);
+        
+        // Removing a while its addition is delivered
+        scene.observers.OnAdd(observedType, [&scene, a](std::span<const Entity> entities) {
+            if (entities.size() == 1 && entities[0] == a) {
+                scene.Remove(a);
+            }
+        });
+        
+        scene.Add(a);
+        scene.observers.Notify(scene);
+        Check(delivered.added == std::vector<Entity>{a} && delivered.removed.empty(), "Changes made by callbacks wait");
+        
+        delivered = {};
+        scene.Add(b);
+        scene.observers.Notify(scene);
+        Check(delivered.removed == std::vector<Entity>{a}, "Changes made by callbacks are delivered next");
+        Check(delivered.added == std::vector<Entity>{b}, "The next batch starts empty");
+    }
+}
+
+int main() {
+    Netting();
+    ReusedIds();
+    RecordingDuringDelivery();
+    
+    std::printf(failures == 0 ? "ComponentObservers tests passed\n" : "%d ComponentObservers tests failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+// Standalone checks for SpatialHashGrid.hpp against brute force, built from the repository root with
+//     clang++ -std=c++20 -O2 -INeonland/Engine Neonland/Engine/Tests/SpatialHashGridTests.cpp
+//         Neonland/Engine/SpatialHashGrid.cpp Neonland/Engine/MathUtils.cpp -o SpatialHashGridTests
+// Exits with 1 and names the failed check if one fails.
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include "../SpatialHashGrid.hpp"
+
+namespace {
+    int failures = 0;
+    size_t allocationCount = 0;
+    
+    void Check(bool condition, const char* what) {
+        if (!condition) {
+            std::printf("FAILED: %s\n", what);
+            failures++;
+        }
+    }
+    
+    using Pairs = std::vector<std::pair<uint32_t, uint32_t>>;
+    
+    struct Circles {
+        std::vector<float2> positions;
+        std::vector<float> radii;
+    };
+    
+    // Mostly similar radii with some zero radius points and 40x outliers, spread over a varying area
+    auto RandomCircles(std::mt19937& random) -> Circles {
+        std::uniform_int_distribution<size_t> countDistribution(0, 400);
+        std::uniform_real_distribution<float> extentDistribution(1, 60);
+        std::uniform_real_distribution<float> unit(0, 1);
+        
+        const size_t count = countDistribution(random);
+        const float extent = extentDistribution(random);
+        
+        Circles circles;
+        
+        for (size_t i = 0; i < count; i++) {
+            circles.positions.push_back(float2{(unit(random) - 0.5f) * extent, (unit(random) - 0.5f) * extent});
+            
+            const float kind = unit(random);
+            circles.radii.push_back(kind < 0.05f ? 0 : kind < 0.1f ? 20 * unit(random) : 0.25f + 0.25f * unit(random));
+        }
+        
+        return circles;
+    }
+    
+    auto Overlapping(const Circles& circles, uint32_t i, uint32_t j, float margin) -> bool {
+        const float dx = circles.positions[j].x - circles.positions[i].x;
+        const float dy = circles.positions[j].y - circles.positions[i].y;
+        const float reach = circles.radii[i] + circles.radii[j] + margin;
+        return dx * dx + dy * dy <= reach * reach;
+    }
+    
+    void NeighbourPairs(std::mt19937& random) {
+        SpatialHashGrid grid;
+        
+        for (int trial = 0; trial < 200; trial++) {
+            const auto circles = RandomCircles(random);
+            const float margin = trial % 2 == 0 ? 0 : 0.5f;
+            const auto count = static_cast<uint32_t>(circles.radii.size());
+            
+            grid.Build(circles.positions, circles.radii);
+            
+            Pairs expected;
+            for (uint32_t i = 0; i < count; i++) {
+                for (uint32_t j = i + 1; j < count; j++) {
+                    if (Overlapping(circles, i, j, margin)) {
+                        expected.emplace_back(i, j);
+                    }
+                }
+            }
+            
+            Pairs pairs;
+            pairs.reserve(expected.size() + count);
+            
+            const size_t allocationsBefore = allocationCount;
+            grid.ForEachNeighbourPair(margin, [&](uint32_t i, uint32_t j) { pairs.emplace_back(i, j); });
+            Check(allocationCount == allocationsBefore, "ForEachNeighbourPair does not allocate");
+            
+            Pairs again;
+            again.reserve(pairs.size());
+            grid.ForEachNeighbourPair(margin, [&](uint32_t i, uint32_t j) { again.emplace_back(i, j); });
+            Check(again == pairs, "Pairs are visited in the same order every call");
+            
+            Check(std::is_sorted(pairs.begin(), pairs.end(), [](auto& a, auto& b) { return a.first < b.first; }),
+                  "Pairs are ordered by their first item");
+            
+            std::sort(pairs.begin(), pairs.end());
+            Check(pairs == expected, "Pairs match brute force, each reported once");
+        }
+    }
+    
+    void Queries(std::mt19937& random) {
+        SpatialHashGrid grid;
+        std::uniform_real_distribution<float> unit(0, 1);
+        
+        for (int trial = 0; trial < 200; trial++) {
+            const auto circles = RandomCircles(random);
+            const auto count = static_cast<uint32_t>(circles.radii.size());
+            
+            grid.Build(circles.positions, circles.radii);
+            
+            const float2 center = {(unit(random) - 0.5f) * 60, (unit(random) - 0.5f) * 60};
+            const float radius = unit(random) < 0.1f ? 0 : 10 * unit(random);
+            
+            std::vector<uint32_t> expected;
+            for (uint32_t i = 0; i < count; i++) {
+                const float dx = circles.positions[i].x - center.x;
+                const float dy = circles.positions[i].y - center.y;
+                const float reach = circles.radii[i] + radius;
+                if (dx * dx + dy * dy <= reach * reach) {
+                    expected.push_back(i);
+                }
+            }
+            
+            std::vector<uint32_t> found;
+            grid.QueryRadius(center, radius, [&](uint32_t i) { found.push_back(i); });
+            std::sort(found.begin(), found.end());
+            Check(found == expected, "QueryRadius matches brute force, each item reported once");
+            
+            const float2 min = {center.x - radius, center.y - radius * 0.5f};
+            const float2 max = {center.x + radius * 0.5f, center.y + radius};
+            
+            expected.clear();
+            for (uint32_t i = 0; i < count; i++) {
+                const float dx = circles.positions[i].x - std::clamp(circles.positions[i].x, min.x, max.x);
+                const float dy = circles.positions[i].y - std::clamp(circles.positions[i].y, min.y, max.y);
+                if (dx * dx + dy * dy <= circles.radii[i] * circles.radii[i]) {
+                    expected.push_back(i);
+                }
+            }
+            
+            found.clear();
+            grid.QueryAABB(min, max, [&](uint32_t i) { found.push_back(i); });
+            std::sort(found.begin(), found.end());
+            Check(found == expected, "QueryAABB matches brute force, each item reported once");
+        }
+    }
+}
+
+// Counts allocations so the checks can tell whether the grid allocates
+auto operator new(size_t size) -> void* {
+    allocationCount++;
+    
+    if (void* memory = std::malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    std::free(memory);
+}
+
+int main() {
+    std::mt19937 random(7);
+    
+    NeighbourPairs(random);
+    Queries(random);
+    
+    std::printf(failures == 0 ? "SpatialHashGrid tests passed\n" : "%d SpatialHashGrid tests failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
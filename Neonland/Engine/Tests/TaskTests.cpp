@@ -0,0 +1,94 @@
+// Standalone checks for Task.hpp, built from the repository root with
+//     clang++ -std=c++20 -O2 -pthread -INeonland/Engine Neonland/Engine/Tests/TaskTests.cpp
+//         Neonland/Engine/ThreadPool.cpp Neonland/Engine/FrameAllocator.cpp -o TaskTests
+// Exits with 1 and names the failed check if one fails.
+
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+
+#include "../Task.hpp"
+
+namespace {
+    int failures = 0;
+    
+    void Check(bool condition, const char* what) {
+        if (!condition) {
+            std::printf("FAILED: %s\n", what);
+            failures++;
+        }
+    }
+    
+    // The background lane only runs on its own threads, never on the thread waiting in SyncWait
+    auto FinishOnWorker(int value) -> Task<int> {
+        co_await ScheduleOn(ThreadPool::GetInstance(), JobPriority::Background);
+        co_return value * 2;
+    }
+    
+    auto FinishOnWorkerVoid(std::atomic<int>& counter) -> Task<> {
+        co_await ScheduleOn(ThreadPool::GetInstance(), JobPriority::Background);
+        counter.fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    auto SumOnWorkers(int count) -> Task<int> {
+        std::vector<Task<int>> tasks;
+        for (int i = 0; i < count; i++) {
+            tasks.push_back(FinishOnWorker(i));
+        }
+        
+        int sum = 0;
+        for (int value : co_await WhenAll(std::move(tasks))) {
+            sum += value;
+        }
+        co_return sum;
+    }
+    
+    // Reuses the stack SyncWait's latch lived on, so a worker still reading it would see garbage
+    [[gnu::noinline]] void ClobberStack() {
+        volatile unsigned char bytes[4096];
+        std::memset(const_cast<unsigned char*>(bytes), 0xa5, sizeof(bytes));
+    }
+    
+    // The task finishes on a worker while the calling thread waits, the latch and the task are
+    // destroyed as soon as SyncWait returns
+    void SyncWaitStress() {
+        std::atomic<int> counter{0};
+        constexpr int rounds = 200000;
+        
+        for (int i = 0; i < rounds; i++) {
+            if (SyncWait(FinishOnWorker(i)) != i * 2) {
+                Check(false, "SyncWait returns the task's result");
+                return;
+            }
+            ClobberStack();
+            
+            SyncWait(FinishOnWorkerVoid(counter));
+            ClobberStack();
+        }
+        
+        Check(counter.load() == rounds, "SyncWait waits for void tasks");
+    }
+    
+    void WhenAllStress() {
+        for (int i = 0; i < 2000; i++) {
+            const int count = 1 + i % 17;
+            if (SyncWait(SumOnWorkers(count)) != count * (count - 1)) {
+                Check(false, "WhenAll collects every result");
+                return;
+            }
+            ClobberStack();
+        }
+    }
+}
+
+int main() {
+    // Background threads finish the tasks while the main thread waits
+    ThreadPool::Configure({2, 2, {}, {}});
+    
+    SyncWaitStress();
+    WhenAllStress();
+    
+    std::printf(failures == 0 ? "Task tests passed\n" : "%d Task tests failed\n", failures);
+    return failures == 0 ? 0 : 1;
+}
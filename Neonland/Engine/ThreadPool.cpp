@@ -1,30 +1,257 @@
 #include "ThreadPool.hpp"
 #include <memory>
+#include <optional>
+#include <cstdlib>
+#include <string>
+#include <cassert>
 
-const uint32_t ThreadPool::ThreadCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
-ThreadPool::ThreadPool()
-: destructing{false} {
-    if (ThreadCount > 0) {
-        threads.reserve(ThreadCount);
+namespace {
+    constexpr size_t dequeCapacity = 1024;
+    constexpr size_t initialInjectionCapacity = 1024;
+    
+    // Failed attempts to find a job before a worker parks
+    constexpr int spinCount = 64;
+
+#if defined(__linux__)
+    constexpr unsigned long maxCpuCount = CPU_SETSIZE;
+#else
+    constexpr unsigned long maxCpuCount = 1024;
+#endif
+    
+    constexpr uint32_t notWorker = static_cast<uint32_t>(-1);
+    thread_local uint32_t currentWorker = notWorker;
+    
+    auto NextRandom() -> uint32_t {
+        thread_local uint32_t state = static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id())) | 1;
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+    
+    auto GetEnvironmentVariable(const char* name) -> std::optional<std::string> {
+#if defined(_MSC_VER)
+        char* value = nullptr;
+        size_t length = 0;
+        if (_dupenv_s(&value, &length, name) != 0 || value == nullptr) {
+            return std::nullopt;
+        }
+        std::string result(value);
+        free(value);
+        return result;
+#else
+        const char* value = std::getenv(name);
+        return value == nullptr ? std::nullopt : std::optional<std::string>(value);
+#endif
+    }
+    
+    // Parses lists such as "0-3,6", skipping malformed entries
+    auto ParseCpuList(const std::string& list) -> std::vector<uint32_t> {
+        std::vector<uint32_t> cpus;
+        size_t pos = 0;
         
-        for (int i = 0; i < ThreadCount; i++) {
-            threads.push_back(std::thread(&ThreadPool::ThreadLoop, this));
+        while (pos < list.size()) {
+            auto end = list.find(',', pos);
+            auto entry = list.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+            pos = end == std::string::npos ? list.size() : end + 1;
+            
+            auto dash = entry.find('-');
+            char* parseEnd = nullptr;
+            
+            const auto first = std::strtoul(entry.c_str(), &parseEnd, 10);
+            if (parseEnd == entry.c_str()) {
+                continue;
+            }
+            
+            auto last = first;
+            if (dash != std::string::npos) {
+                const char* lastBegin = entry.c_str() + dash + 1;
+                last = std::strtoul(lastBegin, &parseEnd, 10);
+                
+                if (parseEnd == lastBegin) {
+                    continue;
+                }
+            }
+            
+            // Reversed ranges and CPUs a cpu_set_t cannot hold are skipped
+            if (last < first || last >= maxCpuCount) {
+                continue;
+            }
+            
+            for (auto cpu = first; cpu <= last; cpu++) {
+                cpus.push_back(static_cast<uint32_t>(cpu));
+            }
         }
+        
+        return cpus;
+    }
+    
+    void PinCurrentThread(const std::vector<uint32_t>& cpus, uint32_t threadIdx) {
+        if (cpus.empty()) {
+            return;
+        }
+
+#if defined(__linux__)
+        const auto cpu = cpus[threadIdx % cpus.size()];
+        assert(cpu < maxCpuCount && "CPU index must fit in a cpu_set_t");
+        if (cpu >= maxCpuCount) {
+            return;
+        }
+        
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        [[maybe_unused]] const int result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        assert(result == 0 && "Thread could not be pinned to its CPU");
+#endif
+    }
+    
+    void LowerCurrentThreadPriority() {
+#if defined(__linux__)
+        setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 10);
+#endif
+    }
+    
+    std::optional<ThreadPoolConfig> configuredConfig;
+    bool configFixed = false;
+}
+
+auto ThreadPoolConfig::FromEnvironment() -> ThreadPoolConfig {
+    ThreadPoolConfig config;
+    config.threadCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+    config.backgroundThreadCount = 1;
+    
+    if (auto value = GetEnvironmentVariable("NEON_THREADS")) {
+        config.threadCount = static_cast<uint32_t>(std::strtoul(value->c_str(), nullptr, 10));
+    }
+    if (auto value = GetEnvironmentVariable("NEON_BACKGROUND_THREADS")) {
+        config.backgroundThreadCount = static_cast<uint32_t>(std::strtoul(value->c_str(), nullptr, 10));
+    }
+    if (auto value = GetEnvironmentVariable("NEON_CPUS")) {
+        config.cpus = ParseCpuList(*value);
+    }
+    if (auto value = GetEnvironmentVariable("NEON_BACKGROUND_CPUS")) {
+        config.backgroundCpus = ParseCpuList(*value);
+    }
+    
+    return config;
+}
+
+void ThreadPool::LaneCounters::RecordStart(Clock::time_point submitTime) {
+    const auto waitNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - submitTime).count());
+    
+    started.fetch_add(1, std::memory_order_relaxed);
+    totalWaitNs.fetch_add(waitNs, std::memory_order_relaxed);
+    
+    auto max = maxWaitNs.load(std::memory_order_relaxed);
+    while (waitNs > max && !maxWaitNs.compare_exchange_weak(max, waitNs, std::memory_order_relaxed)) { }
+}
+
+auto ThreadPool::LaneCounters::GetStats(size_t queued) const -> LaneStats {
+    LaneStats stats;
+    stats.queued = queued;
+    stats.started = started.load(std::memory_order_relaxed);
+    stats.averageWaitMs = stats.started == 0 ? 0 : totalWaitNs.load(std::memory_order_relaxed) / 1e6 / stats.started;
+    stats.maxWaitMs = maxWaitNs.load(std::memory_order_relaxed) / 1e6;
+    return stats;
+}
+
+void ThreadPool::LaneCounters::Reset() {
+    started.store(0, std::memory_order_relaxed);
+    totalWaitNs.store(0, std::memory_order_relaxed);
+    maxWaitNs.store(0, std::memory_order_relaxed);
+}
+
+struct ThreadPool::FunctionJob : Job {
+    std::packaged_task<void()> task;
+    
+    static void Run(Job* job) {
+        auto functionJob = static_cast<FunctionJob*>(job);
+        functionJob->task();
+        delete functionJob;
+    }
+};
+
+void ThreadPool::Batch::Run(Job* job) {
+    auto batch = static_cast<Batch*>(job);
+    batch->RunChunks();
+    batch->queued.fetch_sub(1, std::memory_order_release);
+}
+
+ThreadPool::Worker::Worker()
+: deque(dequeCapacity) { }
+
+ThreadPool::ThreadPool()
+: config{ActiveConfig()}
+, injected(initialInjectionCapacity, nullptr)
+, injectedHead{0}
+, injectedCount{0}
+, parkedCount{0}
+, wakeups{0}
+, destructing{false} {
+    workers.reserve(config.threadCount);
+    threads.reserve(config.threadCount);
+    
+    for (uint32_t i = 0; i < config.threadCount; i++) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    
+    for (uint32_t i = 0; i < config.threadCount; i++) {
+        threads.push_back(std::thread(&ThreadPool::ThreadLoop, this, i));
+    }
+    
+    for (uint32_t i = 0; i < config.backgroundThreadCount; i++) {
+        backgroundThreads.push_back(std::thread(&ThreadPool::BackgroundLoop, this, i));
     }
 }
 
 ThreadPool::~ThreadPool() {
+    destructing.store(true, std::memory_order_seq_cst);
+    
     {
-        std::unique_lock lock(jobMutex);
-        destructing = true;
+        std::unique_lock lock(parkMutex);
     }
     
-    jobCondition.notify_all();
+    parkCondition.notify_all();
+    
+    {
+        std::unique_lock lock(backgroundMutex);
+    }
+    
+    backgroundCondition.notify_all();
     
     for (auto& thread : threads) {
         thread.join();
     }
+    
+    for (auto& thread : backgroundThreads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::Configure(ThreadPoolConfig config) {
+    assert(!configFixed && "ThreadPool must be configured before it is first used");
+    configuredConfig = std::move(config);
+}
+
+auto ThreadPool::ThreadCount() -> uint32_t {
+    return ActiveConfig().threadCount;
+}
+
+auto ThreadPool::ActiveConfig() -> const ThreadPoolConfig& {
+    static const ThreadPoolConfig config = [] {
+        configFixed = true;
+        return configuredConfig ? *configuredConfig : ThreadPoolConfig::FromEnvironment();
+    }();
+    return config;
 }
 
 ThreadPool& ThreadPool::GetInstance() {
@@ -32,42 +259,310 @@ ThreadPool& ThreadPool::GetInstance() {
     return instance;
 }
 
-std::future<void> ThreadPool::SubmitJob(std::function<void()> func) {
-    auto task = std::make_shared<std::packaged_task<void()>>(func);
+std::future<void> ThreadPool::SubmitJob(std::function<void()> func, JobPriority priority) {
+    auto job = new FunctionJob();
+    job->run = &FunctionJob::Run;
+    job->submitTime = Clock::now();
+    job->task = std::packaged_task<void()>(std::move(func));
     
-    std::function<void()> job = [task] { (*task)(); };
+    auto future = job->task.get_future();
     
-    if (ThreadCount > 0) {
-        std::unique_lock lock(jobMutex);
-        jobs.push(job);
+    if (!Enqueue(job, priority)) {
+        job->run(job);
     }
-    else {
-        job();
+    
+    return future;
+}
+
+auto ThreadPool::QueueResume(ResumeJob& job, std::coroutine_handle<> handle, JobPriority priority) -> bool {
+    job.run = [](Job* job) {
+        static_cast<ResumeJob*>(job)->handle.resume();
+    };
+    job.handle = handle;
+    job.submitTime = Clock::now();
+    
+    // Once queued the coroutine may resume and free the job at any time
+    return Enqueue(&job, priority);
+}
+
+auto ThreadPool::Enqueue(Job* job, JobPriority priority) -> bool {
+    if (priority == JobPriority::Background && config.backgroundThreadCount > 0) {
+        {
+            std::unique_lock lock(backgroundMutex);
+            backgroundJobs.push_back(job);
+        }
+        backgroundCondition.notify_one();
+        return true;
+    }
+    
+    if (priority == JobPriority::High && config.threadCount > 0) {
+        Push(job, 1);
+        Wake(1);
+        return true;
     }
     
-    jobCondition.notify_one();
+    return false;
+}
+
+auto ThreadPool::GetStats() const -> Stats {
+    size_t highQueued = injectedCount.load(std::memory_order_relaxed);
+    for (auto& worker : workers) {
+        highQueued += worker->deque.Size();
+    }
+    
+    size_t backgroundQueued;
+    {
+        std::unique_lock lock(backgroundMutex);
+        backgroundQueued = backgroundJobs.size();
+    }
     
-    return task->get_future();
+    return Stats{highCounters.GetStats(highQueued), backgroundCounters.GetStats(backgroundQueued)};
+}
+
+void ThreadPool::ResetStats() {
+    highCounters.Reset();
+    backgroundCounters.Reset();
+}
+
+void ThreadPool::Wait(std::future<void>& job) {
+    while (job.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        if (!RunPendingJob()) {
+            std::this_thread::yield();
+        }
+    }
 }
 
-void ThreadPool::ThreadLoop() {
+bool ThreadPool::RunPendingJob() {
+    if (auto job = TakeJob()) {
+        RunJob(job);
+        return true;
+    }
+    
+    return false;
+}
+
+void ThreadPool::RunJob(Job* job) {
+    highCounters.RecordStart(job->submitTime);
+    job->run(job);
+}
+
+void ThreadPool::ThreadLoop(uint32_t workerIdx) {
+    currentWorker = workerIdx;
+    PinCurrentThread(config.cpus, workerIdx);
+    
+    int idleCount = 0;
+    
+    while (true) {
+        if (auto job = TakeJob()) {
+            RunJob(job);
+            idleCount = 0;
+            continue;
+        }
+        
+        if (destructing.load(std::memory_order_acquire) && !HasQueuedJobs()) {
+            return;
+        }
+        
+        if (++idleCount < spinCount) {
+            std::this_thread::yield();
+            continue;
+        }
+        
+        Park();
+        idleCount = 0;
+    }
+}
+
+void ThreadPool::BackgroundLoop(uint32_t threadIdx) {
+    PinCurrentThread(config.backgroundCpus, threadIdx);
+    LowerCurrentThreadPriority();
+    
     while (true) {
-        std::function<void()> job;
+        Job* job;
         
         {
-            std::unique_lock lock(jobMutex);
-            jobCondition.wait(lock, [this] {
-                return !jobs.empty() || destructing;
+            std::unique_lock lock(backgroundMutex);
+            backgroundCondition.wait(lock, [this] {
+                return !backgroundJobs.empty() || destructing.load(std::memory_order_acquire);
             });
             
-            if (destructing && jobs.empty()) {
+            // Queued background jobs are finished before exiting, so pending saves are written
+            if (backgroundJobs.empty()) {
                 return;
             }
             
-            job = jobs.front();
-            jobs.pop();
+            job = backgroundJobs.front();
+            backgroundJobs.pop_front();
+        }
+        
+        backgroundCounters.RecordStart(job->submitTime);
+        job->run(job);
+    }
+}
+
+void ThreadPool::Push(Job* job, size_t count) {
+    if (currentWorker != notWorker) {
+        auto& deque = workers[currentWorker]->deque;
+        
+        for (; count > 0; count--) {
+            if (!deque.Push(job)) {
+                break;
+            }
+        }
+    }
+    
+    if (count > 0) {
+        PushInjected(job, count);
+    }
+}
+
+void ThreadPool::PushInjected(Job* job, size_t count) {
+    std::unique_lock lock(injectionMutex);
+    
+    auto size = injectedCount.load(std::memory_order_relaxed);
+    
+    if (size + count > injected.size()) {
+        std::vector<Job*> grown(std::max(injected.size() * 2, size + count), nullptr);
+        for (size_t i = 0; i < size; i++) {
+            grown[i] = injected[(injectedHead + i) % injected.size()];
+        }
+        injected = std::move(grown);
+        injectedHead = 0;
+    }
+    
+    for (size_t i = 0; i < count; i++) {
+        injected[(injectedHead + size + i) % injected.size()] = job;
+    }
+    
+    injectedCount.store(size + count, std::memory_order_release);
+}
+
+auto ThreadPool::TakeJob() -> Job* {
+    if (currentWorker != notWorker) {
+        if (auto job = workers[currentWorker]->deque.Pop()) {
+            return job;
+        }
+    }
+    
+    if (auto job = TakeInjected()) {
+        return job;
+    }
+    
+    const auto workerCount = static_cast<uint32_t>(workers.size());
+    
+    if (workerCount == 0) {
+        return nullptr;
+    }
+    
+    const uint32_t start = NextRandom() % workerCount;
+    
+    for (uint32_t i = 0; i < workerCount; i++) {
+        const uint32_t victim = (start + i) % workerCount;
+        
+        if (victim == currentWorker) {
+            continue;
+        }
+        
+        if (auto job = workers[victim]->deque.Steal()) {
+            return job;
+        }
+    }
+    
+    return nullptr;
+}
+
+auto ThreadPool::TakeInjected() -> Job* {
+    if (injectedCount.load(std::memory_order_acquire) == 0) {
+        return nullptr;
+    }
+    
+    std::unique_lock lock(injectionMutex);
+    
+    auto size = injectedCount.load(std::memory_order_relaxed);
+    
+    if (size == 0) {
+        return nullptr;
+    }
+    
+    auto job = injected[injectedHead];
+    injectedHead = (injectedHead + 1) % injected.size();
+    injectedCount.store(size - 1, std::memory_order_release);
+    
+    return job;
+}
+
+auto ThreadPool::HasQueuedJobs() const -> bool {
+    if (injectedCount.load(std::memory_order_acquire) > 0) {
+        return true;
+    }
+    
+    for (auto& worker : workers) {
+        if (!worker->deque.Empty()) {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+void ThreadPool::Park() {
+    std::unique_lock lock(parkMutex);
+    
+    // Pairs with the fence in Wake: either the submitter sees this worker parked
+    // or this worker sees the submitted job
+    parkedCount.fetch_add(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    
+    if (!HasQueuedJobs() && !destructing.load(std::memory_order_acquire)) {
+        parkCondition.wait(lock, [this] {
+            return wakeups > 0 || destructing.load(std::memory_order_acquire);
+        });
+        
+        if (wakeups > 0) {
+            wakeups--;
         }
+    }
+    
+    parkedCount.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void ThreadPool::Wake(size_t count) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    
+    // Running workers find the jobs themselves
+    if (parkedCount.load(std::memory_order_seq_cst) == 0) {
+        return;
+    }
+    
+    size_t notifyCount;
+    
+    {
+        std::unique_lock lock(parkMutex);
+        
+        const uint32_t parked = parkedCount.load(std::memory_order_relaxed);
+        const uint32_t previous = wakeups;
         
-        job();
+        wakeups = static_cast<uint32_t>(std::min<size_t>(wakeups + count, parked));
+        notifyCount = wakeups - std::min(previous, wakeups);
+    }
+    
+    if (notifyCount >= parkedCount.load(std::memory_order_relaxed)) {
+        parkCondition.notify_all();
+    }
+    else {
+        for (size_t i = 0; i < notifyCount; i++) {
+            parkCondition.notify_one();
+        }
     }
 }
+
+void ThreadPool::PushBatch(Batch& batch) {
+    // The calling thread runs chunks itself, so one queued copy per other chunk is enough
+    const size_t copies = batch.chunkCount - 1;
+    
+    batch.queued.store(copies, std::memory_order_relaxed);
+    batch.submitTime = Clock::now();
+    
+    Push(&batch, copies);
+    Wake(copies);
+}
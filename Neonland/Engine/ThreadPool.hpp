@@ -1,16 +1,58 @@
 #pragma once
 
 #include <vector>
-#include <queue>
+#include <memory>
 #include <functional>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <future>
+#include <atomic>
+#include <algorithm>
+#include <type_traits>
+#include <chrono>
+#include <deque>
+#include <coroutine>
 
+#include "WorkStealingDeque.hpp"
+
+struct ThreadPoolConfig {
+    // Workers running high priority jobs. Threads waiting in ParallelFor and Wait help them.
+    uint32_t threadCount;
+    
+    // Threads that only run background jobs. With none, background jobs run when submitted.
+    uint32_t backgroundThreadCount;
+    
+    // Worker i is pinned to cpus[i % cpus.size()]. Empty lists leave the threads unpinned.
+    // Pinning is only supported on Linux.
+    std::vector<uint32_t> cpus;
+    std::vector<uint32_t> backgroundCpus;
+    
+    // hardware_concurrency() - 1 workers and one background thread, overridden by the environment
+    // variables NEON_THREADS, NEON_BACKGROUND_THREADS, NEON_CPUS and NEON_BACKGROUND_CPUS.
+    // CPU lists are comma separated CPU numbers or ranges, e.g. "0-3,6". Reversed ranges and
+    // CPUs past CPU_SETSIZE are skipped.
+    static auto FromEnvironment() -> ThreadPoolConfig;
+};
+
+enum class JobPriority {
+    // Tick work, run by the workers and by threads waiting on other jobs
+    High,
+    // Asset loading, save files and the like, run only by the background threads
+    Background,
+};
+
+// Each worker has its own work-stealing deque. Jobs submitted by a worker go to its deque,
+// jobs submitted by other threads go to a shared injection queue. Idle workers steal from random
+// victims, spin for a while and then park until a submit wakes them.
+// Background jobs have their own FIFO and threads, so they never occupy a worker.
 class ThreadPool final {
 public:
-    static const uint32_t ThreadCount;
+    // Replaces the configuration from the environment. Must be called before the pool is first used,
+    // which includes constructing a Scene.
+    static void Configure(ThreadPoolConfig config);
+    
+    static auto ThreadCount() -> uint32_t;
     
     static ThreadPool& GetInstance();
     
@@ -19,17 +61,201 @@ public:
     
     ~ThreadPool();
     
-    std::future<void> SubmitJob(std::function<void()> func);
+    std::future<void> SubmitJob(std::function<void()> func, JobPriority priority = JobPriority::High);
+    
+    // Runs queued jobs on the calling thread until job has finished.
+    // Jobs that wait on jobs they submitted must use this so the pool cannot deadlock
+    // when every thread is waiting.
+    void Wait(std::future<void>& job);
+    
+    // Runs one queued job or ParallelFor chunk on the calling thread. Returns false if there was none.
+    bool RunPendingJob();
+    
+    // Splits [begin, end) into at most ThreadCount() + 1 chunks of at least grain indices, or one chunk
+    // if there are fewer, and calls func(chunkIdx, chunkBegin, chunkEnd) for each, with chunks in index
+    // order covering ascending ranges.
+    // The calling thread runs chunks too and returns once all of them have finished.
+    // Nothing is allocated: the chunks are claimed from a batch on the caller's stack.
+    template<typename Func> requires std::invocable<Func&, size_t, size_t, size_t>
+    void ParallelFor(size_t begin, size_t end, size_t grain, Func&& func);
+    
+    struct LaneStats {
+        // Jobs waiting to start. Approximate for the high priority lane.
+        size_t queued = 0;
+        size_t started = 0;
+        // Time from submit to start. ParallelFor chunks run by the caller are not counted.
+        double averageWaitMs = 0;
+        double maxWaitMs = 0;
+    };
+    
+    struct Stats {
+        LaneStats high;
+        LaneStats background;
+    };
+    
+    auto GetStats() const -> Stats;
+    void ResetStats();
+    
+    // Job that resumes a coroutine. Kept by the caller, usually in the coroutine frame,
+    // so queueing a resumption allocates nothing.
+    struct ResumeJob;
+    
+    // Queues handle.resume() on the priority's lane. Returns false without queueing when the lane
+    // has no threads, the caller then resumes the coroutine itself.
+    auto QueueResume(ResumeJob& job, std::coroutine_handle<> handle, JobPriority priority) -> bool;
 private:
+    using Clock = std::chrono::steady_clock;
+    
+    // Queued work. run is responsible for releasing the job.
+    struct Job {
+        void (*run)(Job* job);
+        Clock::time_point submitTime;
+    };
+    
+    struct FunctionJob;
+    
+    // Queued once per helper thread wanted. Each run claims chunks until none are left.
+    struct Batch : Job {
+        void (*invoke)(void* func, size_t chunkIdx, size_t begin, size_t end);
+        void* func;
+        
+        size_t begin;
+        size_t count;
+        size_t chunkCount;
+        
+        std::atomic<size_t> nextChunk;
+        // Chunks that have not finished
+        std::atomic<size_t> remaining;
+        // Queued copies that have not run yet. The batch is not touched after both counts reach 0.
+        std::atomic<size_t> queued;
+        
+        void RunChunks();
+        static void Run(Job* job);
+    };
+    
+    struct Worker {
+        WorkStealingDeque<Job> deque;
+        
+        Worker();
+    };
+    
+    struct LaneCounters {
+        std::atomic<uint64_t> started{0};
+        std::atomic<uint64_t> totalWaitNs{0};
+        std::atomic<uint64_t> maxWaitNs{0};
+        
+        void RecordStart(Clock::time_point submitTime);
+        auto GetStats(size_t queued) const -> LaneStats;
+        void Reset();
+    };
+    
+    const ThreadPoolConfig config;
+    
+    std::vector<std::unique_ptr<Worker>> workers;
     std::vector<std::thread> threads;
-    std::queue<std::function<void()>> jobs;
     
-    std::mutex jobMutex;
-    std::condition_variable jobCondition;
+    mutable std::mutex backgroundMutex;
+    std::condition_variable backgroundCondition;
+    std::deque<Job*> backgroundJobs;
+    std::vector<std::thread> backgroundThreads;
+    
+    LaneCounters highCounters;
+    LaneCounters backgroundCounters;
+    
+    // Ring buffer of jobs from threads that are not workers. Only grows when full.
+    std::mutex injectionMutex;
+    std::vector<Job*> injected;
+    size_t injectedHead;
+    std::atomic<size_t> injectedCount;
     
-    bool destructing;
+    // Parked workers wait for wakeups, which submits hand out up to the number of parked workers
+    std::mutex parkMutex;
+    std::condition_variable parkCondition;
+    std::atomic<uint32_t> parkedCount;
+    uint32_t wakeups;
+    
+    std::atomic<bool> destructing;
     
     ThreadPool();
     
-    void ThreadLoop();
+    // The configuration is fixed by the first call
+    static auto ActiveConfig() -> const ThreadPoolConfig&;
+    
+    void ThreadLoop(uint32_t workerIdx);
+    void BackgroundLoop(uint32_t threadIdx);
+    
+    // Records the wait of a high priority job and runs it
+    void RunJob(Job* job);
+    
+    // Queues job on the priority's lane. Returns false without queueing when the lane has no threads.
+    auto Enqueue(Job* job, JobPriority priority) -> bool;
+    
+    // Queues job count times on the calling worker's deque, or on the injection queue
+    void Push(Job* job, size_t count);
+    void PushInjected(Job* job, size_t count);
+    
+    // Own deque first, then the injection queue, then a random victim
+    auto TakeJob() -> Job*;
+    auto TakeInjected() -> Job*;
+    
+    auto HasQueuedJobs() const -> bool;
+    
+    void Park();
+    void Wake(size_t count);
+    
+    void PushBatch(Batch& batch);
+};
+
+struct ThreadPool::ResumeJob : Job {
+    std::coroutine_handle<> handle;
 };
+
+inline void ThreadPool::Batch::RunChunks() {
+    size_t chunkIdx;
+    while ((chunkIdx = nextChunk.fetch_add(1, std::memory_order_relaxed)) < chunkCount) {
+        const size_t chunkBegin = begin + count * chunkIdx / chunkCount;
+        const size_t chunkEnd = begin + count * (chunkIdx + 1) / chunkCount;
+        
+        invoke(func, chunkIdx, chunkBegin, chunkEnd);
+        remaining.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+template<typename Func> requires std::invocable<Func&, size_t, size_t, size_t>
+void ThreadPool::ParallelFor(size_t begin, size_t end, size_t grain, Func&& func) {
+    if (begin >= end) {
+        return;
+    }
+    
+    const size_t count = end - begin;
+    // Rounded down, so every chunk has at least grain indices unless there is only one
+    const size_t chunkCount = std::clamp<size_t>(count / std::max<size_t>(grain, 1), 1, ThreadCount() + 1);
+    
+    if (chunkCount == 1) {
+        func(0, begin, end);
+        return;
+    }
+    
+    Batch batch;
+    batch.run = &Batch::Run;
+    batch.invoke = [](void* func, size_t chunkIdx, size_t begin, size_t end) {
+        (*static_cast<std::remove_reference_t<Func>*>(func))(chunkIdx, begin, end);
+    };
+    batch.func = const_cast<void*>(static_cast<const void*>(std::addressof(func)));
+    batch.begin = begin;
+    batch.count = count;
+    batch.chunkCount = chunkCount;
+    batch.nextChunk.store(0, std::memory_order_relaxed);
+    batch.remaining.store(chunkCount, std::memory_order_relaxed);
+    
+    PushBatch(batch);
+    
+    batch.RunChunks();
+    
+    // Chunks claimed by other threads may still be running, help with other work meanwhile
+    while (batch.remaining.load(std::memory_order_acquire) > 0 || batch.queued.load(std::memory_order_acquire) > 0) {
+        if (!RunPendingJob()) {
+            std::this_thread::yield();
+        }
+    }
+}
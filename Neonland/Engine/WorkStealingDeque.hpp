@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+// Chase-Lev deque of pointers with a fixed power-of-two capacity.
+// The owning thread pushes and pops at the bottom, other threads steal from the top.
+// Uses the C11 memory orderings from Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models".
+template<typename T>
+class WorkStealingDeque {
+public:
+    explicit WorkStealingDeque(size_t capacity)
+    : mask{capacity - 1}
+    , buffer{std::make_unique<std::atomic<T*>[]>(capacity)}
+    , top{0}
+    , bottom{0} { }
+    
+    // Owner only. Returns false if the deque is full.
+    auto Push(T* item) -> bool {
+        const int64_t b = bottom.load(std::memory_order_relaxed);
+        const int64_t t = top.load(std::memory_order_acquire);
+        
+        if (b - t > static_cast<int64_t>(mask)) {
+            return false;
+        }
+        
+        buffer[b & mask].store(item, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+    
+    // Owner only. Takes the most recently pushed item.
+    auto Pop() -> T* {
+        const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+        
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        
+        T* item = buffer[b & mask].load(std::memory_order_relaxed);
+        
+        if (t == b) {
+            // Last item, race the thieves for it
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                item = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        
+        return item;
+    }
+    
+    // Any thread. Takes the oldest item, returns null if empty or if another thread won the race.
+    auto Steal() -> T* {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t b = bottom.load(std::memory_order_acquire);
+        
+        if (t >= b) {
+            return nullptr;
+        }
+        
+        T* item = buffer[t & mask].load(std::memory_order_relaxed);
+        
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+        
+        return item;
+    }
+    
+    // Approximate when other threads are pushing or stealing
+    auto Size() const -> size_t {
+        const int64_t size = bottom.load(std::memory_order_relaxed) - top.load(std::memory_order_relaxed);
+        return size > 0 ? static_cast<size_t>(size) : 0;
+    }
+    
+    auto Empty() const -> bool {
+        return top.load(std::memory_order_acquire) >= bottom.load(std::memory_order_acquire);
+    }
+private:
+    const size_t mask;
+    std::unique_ptr<std::atomic<T*>[]> buffer;
+    
+    // Separate cache lines so the owner and the thieves do not share one
+    alignas(64) std::atomic<int64_t> top;
+    alignas(64) std::atomic<int64_t> bottom;
+};
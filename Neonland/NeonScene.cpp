@@ -5,11 +5,39 @@
 #include <atomic>
 #include <map>
 #include <bit>
+#include <span>
 
 #include "Material.hpp"
 #include "./Components/Button.hpp"
 #include "./Components/Anchor.hpp"
 #include "./Components/Pickup.hpp"
+#include "./Engine/ThreadPool.hpp"
+#include "./Engine/SimdKernels.hpp"
+#include "./Engine/Frustum.hpp"
+
+namespace {
+    // Radius of the sphere around the origin that holds each model at scale 1
+    constexpr std::array<float, MeshTypeCount> meshRadii = {
+        0.5f,   // SPHERE_MESH
+        0.867f, // CUBE_MESH
+        1.0f,   // CROSSHAIR_MESH
+        0.708f, // PLANE_MESH
+        1.0f,   // SPREAD_MESH
+        0.5f,   // SHARD_MESH
+    };
+    
+    // Places a body between its previous and current physics state, unless gameplay placed it
+    template<typename TransformT, typename PhysicsT>
+    void Interpolate(TransformT&& tf, PhysicsT&& physics, double interpolation) {
+        if (!tf.teleported) {
+            tf.position = physics.GetInterpolatedPosition(interpolation);
+        }
+        
+        if (!tf.rotationSet) {
+            tf.rotation = physics.GetInterpolatedRotation(interpolation);
+        }
+    }
+}
 
 NeonScene::NeonScene(size_t maxInstanceCount, double timestep)
 : _maxInstanceCount{maxInstanceCount}
@@ -23,6 +51,17 @@ NeonScene::NeonScene(size_t maxInstanceCount, double timestep)
 }
 
 void NeonScene::Start() {
+    // Integration and interpolation walk every physics body each tick and frame
+    _scene.GetOwningGroup<Transform, Physics>();
+    
+    _scene.OnRemove<Mesh>([this](std::span<const Entity> entities) {
+        for (auto entity : entities) {
+            _renderBuckets.Remove(entity);
+        }
+    });
+    
+    RegisterTickSystems();
+    
     {
         auto saveFile = std::ifstream(saveFilePath + L"neon_save.save");
         
@@ -149,11 +188,15 @@ void NeonScene::SetUnlockLevel(int lvl) {
     
     if (lvl != _unlockLevel) {
         _unlockLevel = lvl;
-        auto saveFile = std::ofstream(saveFilePath + L"neon_save.save");
         
-        if (saveFile) {
-            saveFile << _unlockLevel;
-        }
+        // Off the tick, the disk write can take longer than a frame
+        ThreadPool::GetInstance().SubmitJob([path = saveFilePath + L"neon_save.save", lvl] {
+            auto saveFile = std::ofstream(path);
+            
+            if (saveFile) {
+                saveFile << lvl;
+            }
+        }, JobPriority::Background);
     }
     
     if (_gameState == GameState::Menu) {
@@ -250,17 +293,19 @@ void NeonScene::SetGameState(GameState state) {
 
 void NeonScene::ClearLevel() {
     _scene.GetGroup<Enemy>()->Update([this](auto entity, auto& enemy) {
-        _scene.DestroyEntity(entity);
+        _scene.Commands().DestroyEntity(entity);
     });
     
     _scene.GetGroup<PlayerProjectile>()->Update([this](auto entity, auto& projectile) {
-        _scene.DestroyEntity(entity);
+        _scene.Commands().DestroyEntity(entity);
     });
     
     _scene.GetGroup<Pickup>()->Update([this](auto entity, auto& projectile) {
-        _scene.DestroyEntity(entity);
+        _scene.Commands().DestroyEntity(entity);
     });
     
+    _scene.FlushCommands();
+    
     _destroyedSincePickup = 0;
     
     _scene.Get<Physics>(player).prevPosition = {0, 0, 0};
@@ -338,9 +383,13 @@ void NeonScene::UpdateLevelProgress(double time) {
 void NeonScene::SpawnSubWave(const Wave::SubWave& subWave) {
     float2 mapSize = CurrentLevel().mapSize;
     
-    float3 spawnPos = {0, 0, 0};
-    
-    for (size_t i = 0; i < subWave.count; i++) {
+    _scene.Instantiate(subWave.type.MakePrefab(), subWave.count, [&](size_t i,
+                                                                     auto& physics,
+                                                                     auto& tf,
+                                                                     auto& mesh,
+                                                                     auto& enemy,
+                                                                     auto& hp) {
+        float3 spawnPos = {0, 0, 0};
         float sign = RandomBetween(0.0f, 1.0f) > 0.5f ? -1 : 1;
         
         if (RandomBetween(0.0f, 1.0f) > 0.5f) {
@@ -352,19 +401,11 @@ void NeonScene::SpawnSubWave(const Wave::SubWave& subWave) {
             spawnPos.y = RandomBetween(-mapSize.y / 2, mapSize.y / 2);
         }
         
-        spawnPos.z = -subWave.type.scale.z / 2;
+        spawnPos.z = tf.position.z;
         
-        auto mesh = subWave.type.mesh;
-        mesh.tint = {0, 0, 0, 1};
-        auto enemy = subWave.type.enemy;
-        
-        auto tf = Transform(spawnPos, float3{0, RandomBetween(0.0f, 360.0f), 0}, subWave.type.scale);
-        _scene.CreateEntity(Physics(tf, float3{0, 0, 0}, float3{0, -90 * subWave.type.enemy.maxMovementSpeed, 0}, 0.6f),
-                            std::move(tf),
-                            std::move(mesh),
-                            std::move(enemy),
-                            HP(subWave.type.maxHP));
-    }
+        tf = Transform(spawnPos, float3{0, RandomBetween(0.0f, 360.0f), 0}, tf.scale);
+        physics = Physics(tf, physics.velocity, physics.angularVelocity, physics.collisionRadius);
+    });
 }
 
 float NeonScene::RandomBetween(float a, float b) {
@@ -384,7 +425,7 @@ Weapon& NeonScene::CurrentWeapon() {
     return weapons[weaponIdx];
 }
 
-Entity NeonScene::CreatePickup(float3 pos) {
+void NeonScene::CreatePickup(float3 pos) {
     pos.z = -0.5f;
     
     float3 scale = {1, 1, 1};
@@ -402,10 +443,10 @@ Entity NeonScene::CreatePickup(float3 pos) {
     }
     
     auto tf = Transform(pos, float3{90, 0, 0}, scale);
-    return _scene.CreateEntity(Physics(tf, float3{0, 0, 0}, float3{0, 0, 90 * RandomBetween(-1.0f, 1.0f)}),
-                               std::move(tf),
-                               Pickup(type),
-                               Mesh(SPHERE_MESH, mat));
+    _scene.Commands().CreateEntity(Physics(tf, float3{0, 0, 0}, float3{0, 0, 90 * RandomBetween(-1.0f, 1.0f)}),
+                                   std::move(tf),
+                                   Pickup(type),
+                                   Mesh(SPHERE_MESH, mat));
 }
 
 void NeonScene::Update(float aspectRatio) {
@@ -444,39 +485,75 @@ void NeonScene::Update(float aspectRatio) {
     }
 }
 
+void NeonScene::RegisterTickSystems() {
+    // Systems that are not Exclusive must not create groups, so theirs are created here
+    _scene.GetGroup<Physics, Enemy>();
+    _scene.GetGroup<Transform, Physics, Enemy>();
+    _scene.GetGroup<Transform, Physics>(GetComponentMask<PlayerProjectile>());
+    _scene.GetGroup<Pickup, Physics, Transform>();
+    _scene.GetGroup<Transform, Physics, PlayerProjectile>();
+    _scene.GetGroup<Transform, Physics, Enemy, HP, Mesh>();
+    
+    _tickSystems.Add<System<Exclusive>>("LevelProgress", [this] { UpdateLevelProgress(_tickTime); });
+    _tickSystems.Add<System<Read<Enemy>, Write<Physics>>>("SteerEnemies", [this] { SteerEnemies(_tickTime); });
+    _tickSystems.Add<System<Write<Physics>>>("ClampPlayer", [this] { ClampPlayer(); });
+    _tickSystems.Add<System<Exclusive>>("FireWeapon", [this] { FireWeapon(_tickTime); });
+    // Game over also hides and shows UI meshes
+    _tickSystems.Add<System<Read<Transform, Physics>, Write<Enemy, HP, Mesh, Resources::Audio, Resources::GameState>>>("AttackPlayer", [this] { AttackPlayer(_tickTime); });
+    // The collected pickups are destroyed in HitEnemies' flush
+    _tickSystems.Add<System<Read<Pickup, Physics, Transform>, Write<HP, Resources::Audio, Resources::PowerUps>>>("CollectPickups", [this] { CollectPickups(_tickTime); });
+    // Bodies do not move until IntegratePhysics, so hits are found alongside AttackPlayer and CollectPickups
+    _tickSystems.Add<System<Read<Transform, Physics>>>("FindHits", [this] { FindHits(); });
+    _tickSystems.Add<System<Exclusive>>("HitEnemies", [this] { HitEnemies(_tickTime); });
+    _tickSystems.Add<System<Exclusive>>("DestroyDeadEnemies", [this] { DestroyDeadEnemies(); });
+    _tickSystems.Add<System<Write<Transform, Physics>>>("IntegratePhysics", [this] { IntegratePhysics(); });
+    _tickSystems.Add<System<Read<Transform>, Write<Physics>>>("SeparateBodies", [this] { SeparateBodies(); });
+    
+    _scene.ReserveCommandBuffers(_tickSystems.SystemCount());
+}
+
+std::string NeonScene::DumpTickSchedule() const {
+    return _tickSystems.Dump();
+}
+
 void NeonScene::Tick(double time) {
-    UpdateLevelProgress(time);
-    
-    if (threeSixtyShots && time > threeSixtyShotsEndTime) {
-        threeSixtyShots = false;
-    }
+    _tickTime = time;
+    _tickSystems.Run();
     
+    _scene.NotifyObservers();
+}
+
+void NeonScene::SteerEnemies(double time) {
     _scene.Get<Physics>(player).velocity = moveDir * movementSpeed;
     
-    {
-        float3 targetPos = _scene.Get<Physics>(player).position;
-        
-        _scene.GetGroup<Physics, Enemy>()->UpdateParallel([targetPos, time](auto entity, auto& physics, auto& enemy) {
-            float3 dir = targetPos - physics.position;
-            dir.z = 0;
-            dir = VecNormalize(dir);
-            
-            float3 newVel = physics.velocity + dir * enemy.acceleration;
-            float len = VecLength(newVel);
-            if (len > enemy.maxMovementSpeed) {
-                newVel /= len;
-                newVel *= enemy.maxMovementSpeed;
-            }
-            physics.velocity = newVel;
-            physics.rotation.z = std::atan2f(dir.y, dir.x) * RadToDeg;
-        });
-    }
+    float3 targetPos = _scene.Get<Physics>(player).position;
     
-    {
-        float3 pos = _scene.Get<Physics>(player).position;
-        pos.x = std::clamp(pos.x, -CurrentLevel().mapSize.x / 2, CurrentLevel().mapSize.x / 2);
-        pos.y = std::clamp(pos.y, -CurrentLevel().mapSize.y / 2, CurrentLevel().mapSize.y / 2);
-        _scene.Get<Physics>(player).position = pos;
+    _scene.GetGroup<Physics, Enemy>()->UpdateParallel([targetPos, time](auto entity, auto& physics, auto& enemy) {
+        float3 dir = targetPos - physics.position;
+        dir.z = 0;
+        dir = VecNormalize(dir);
+        
+        float3 newVel = physics.velocity + dir * enemy.acceleration;
+        float len = VecLength(newVel);
+        if (len > enemy.maxMovementSpeed) {
+            newVel /= len;
+            newVel *= enemy.maxMovementSpeed;
+        }
+        physics.velocity = newVel;
+        physics.rotation.z = std::atan2f(dir.y, dir.x) * RadToDeg;
+    }, GetComponentMask<Enemy>());
+}
+
+void NeonScene::ClampPlayer() {
+    float3 pos = _scene.Get<Physics>(player).position;
+    pos.x = std::clamp(pos.x, -CurrentLevel().mapSize.x / 2, CurrentLevel().mapSize.x / 2);
+    pos.y = std::clamp(pos.y, -CurrentLevel().mapSize.y / 2, CurrentLevel().mapSize.y / 2);
+    _scene.Get<Physics>(player).position = pos;
+}
+
+void NeonScene::FireWeapon(double time) {
+    if (threeSixtyShots && time > threeSixtyShotsEndTime) {
+        threeSixtyShots = false;
     }
     
     prevSpreadMult = spreadMult;
@@ -500,31 +577,32 @@ void NeonScene::Tick(double time) {
             perShotCount = 6;
         }
         
-        for (int n = 0; n < directionCount; n++) {
-            for (int i = 0; i < perShotCount; i++) {
-                float2 vel = aimDir + float2{-aimDir.y, aimDir.x} * CurrentWeapon().spread * spreadMult * RandomBetween(-1.0f, 1.0f);
-                vel = VecNormalize(vel);
-                
-                float4 vel4 = RotationMatrix(zAxis, n * 30) * float4 { vel.x, vel.y, 0, 1 };
-                
-                vel = {vel4.x, vel4.y};
-                
-                float r = std::atan2f(vel.y, vel.x) * RadToDeg;
-                
-                PlayerProjectile projectile = CurrentWeapon().projectile;
-                projectile.despawnTime = time + projectile.lifespan;
-                vel *= projectile.speed;
-                
-                auto mesh = CurrentWeapon().projectileMesh;
-                
-                auto tf = Transform(spawnPos, float3{0, 0, r}, float3{1.0f, 0.5f, 0.5f} * CurrentWeapon().projectileSize);
-                _scene.CreateEntity(Physics(tf, float3{vel.x, vel.y, 0}),
-                                    std::move(tf),
-                                    std::move(mesh),
-                                    std::move(projectile));
-                
-            }
-        }
+        auto prefab = CurrentWeapon().MakeProjectilePrefab();
+        auto& prefabProjectile = prefab.Get<PlayerProjectile>();
+        prefabProjectile.despawnTime = time + prefabProjectile.lifespan;
+        
+        _scene.Instantiate(prefab, directionCount * perShotCount, [&](size_t i,
+                                                                      auto& physics,
+                                                                      auto& tf,
+                                                                      auto& mesh,
+                                                                      auto& projectile) {
+            int n = static_cast<int>(i) / perShotCount;
+            
+            float2 vel = aimDir + float2{-aimDir.y, aimDir.x} * CurrentWeapon().spread * spreadMult * RandomBetween(-1.0f, 1.0f);
+            vel = VecNormalize(vel);
+            
+            float4 vel4 = RotationMatrix(zAxis, n * 30) * float4 { vel.x, vel.y, 0, 1 };
+            
+            vel = {vel4.x, vel4.y};
+            
+            float r = std::atan2f(vel.y, vel.x) * RadToDeg;
+            
+            vel *= projectile.speed;
+            
+            tf = Transform(spawnPos, float3{0, 0, r}, tf.scale);
+            physics = Physics(tf, float3{vel.x, vel.y, 0});
+        });
+        
         double cooldown = CurrentWeapon().cooldown;
         if (threeSixtyShots && cooldown < 0.15) {
             cooldown = 0.15;
@@ -538,116 +616,238 @@ void NeonScene::Tick(double time) {
     else if (CurrentWeapon().cooldownEndTime < time){
         spreadMult = std::clamp(spreadMult -= 0.5f * _timestep, 1.0f, 2.0f);
     }
+}
+
+void NeonScene::AttackPlayer(double time) {
+    auto&& playerTf = _scene.Read<Transform>(player);
+    auto&& playerPhysics = _scene.Read<Physics>(player);
+
+#ifdef NEON_ARCHETYPE_STORAGE
+    std::atomic<int> totalDamage = 0;
+    _scene.GetGroup<Transform, Physics, Enemy>()->UpdateParallel([&, t = time](auto entity,
+                                                                               auto& tf,
+                                                                               auto& physics,
+                                                                               auto& enemy) {
+        if (Physics::Overlapping(physics, playerPhysics, tf, playerTf, 0.05f)) {
+            if (enemy.cooldownEndTime < t) {
+                totalDamage += enemy.attackDamage;
+                enemy.cooldownEndTime = t + enemy.attackCooldown;
+            }
+        }
+    }, GetComponentMask<Transform, Physics>());
+#else
+    // Every body is tested against the player in one pass over the columns, then the few touching
+    // enemies attack. The player touches itself but is not an enemy.
+    auto bodies = _scene.GetOwningGroup<Transform, Physics>();
+    const float playerRadius = playerPhysics.GetScaledCollisionRadius(playerTf);
+    size_t touchingCount = 0;
+    
+    bodies->ReadColumns([&](size_t count, TransformColumns& tf, PhysicsColumns& physics) {
+        _touchRadii.resize(count);
+        _touchingBodies.resize(count);
+        
+        auto& scale = tf.Column<&Transform::scale>();
+        ScaleRadii(physics.Column<&Physics::collisionRadius>().Data(), scale.X(), scale.Y(), scale.Z(), _touchRadii.data(), count);
+        
+        auto& position = physics.Column<&Physics::position>();
+        touchingCount = OverlapCircles({position.X(), position.Y(), _touchRadii.data(), count},
+                                       playerPhysics.position.x, playerPhysics.position.y, playerRadius, 0.05f, _touchingBodies.data());
+    });
     
-    {
-        auto& playerTf = _scene.Get<Transform>(player);
-        auto& playerPhysics = _scene.Get<Physics>(player);
-        
-        std::atomic<int> totalDamage = 0;
-        _scene.GetGroup<Transform, Physics, Enemy>()->UpdateParallel([&, t = time](auto entity,
-                                                                                   auto& tf,
-                                                                                   auto& physics,
-                                                                                   auto& enemy) {
-            if (Physics::Overlapping(physics, playerPhysics, tf, playerTf, 0.05f)) {
-                if (enemy.cooldownEndTime < t) {
-                    totalDamage += enemy.attackDamage;
-                    enemy.cooldownEndTime = t + enemy.attackCooldown;
-                }
+    int totalDamage = 0;
+    
+    for (size_t i = 0; i < touchingCount; i++) {
+        const auto entity = bodies->GetEntities()[_touchingBodies[i]];
+        
+        if (_scene.Has<Enemy>(entity)) {
+            auto& enemy = _scene.Get<Enemy>(entity);
+            
+            if (enemy.cooldownEndTime < time) {
+                totalDamage += enemy.attackDamage;
+                enemy.cooldownEndTime = time + enemy.attackCooldown;
             }
-        });
+        }
+    }
+#endif
+    
+    _scene.Get<HP>(player).Decrease(totalDamage);
+    if (totalDamage > 0) {
+        auto& playerMesh = _scene.Get<Mesh>(player);
+        playerMesh.tint.x = std::clamp(playerMesh.tint.x - 0.25f * totalDamage, 0.0f, 1.0f);
         
-        _scene.Get<HP>(player).Decrease(totalDamage);
-        if (totalDamage > 0) {
-            auto& playerMesh = _scene.Get<Mesh>(player);
-            playerMesh.tint.x = std::clamp(playerMesh.tint.x - 0.25f * totalDamage, 0.0f, 1.0f);
+        if (_scene.Get<HP>(player).Get() <= 0) {
+            SetGameState(GameState::GameOver);
+            _audios.push_back(GAME_OVER_AUDIO);
+        }
+        else {
+            _audios.push_back(LOSE_HP_AUDIO);
+        }
+    }
+    
+    hpField.SetValue(_scene.Get<HP>(player).Get());
+}
+
+void NeonScene::CollectPickups(double time) {
+    auto&& playerTf = _scene.Read<Transform>(player);
+    auto&& playerPhysics = _scene.Read<Physics>(player);
+    
+    std::atomic<int> heal = 0;
+    std::atomic<bool> collected360 = false;
+    
+    _scene.GetGroup<Pickup, Physics, Transform>()->UpdateParallel([&, this](auto entity,
+                                                                            auto& pickup,
+                                                                            auto& physics,
+                                                                            auto& tf) {
+        if (Physics::Overlapping(playerPhysics, physics, playerTf, tf, 0.1f)) {
             
-            if (_scene.Get<HP>(player).Get() <= 0) {
-                SetGameState(GameState::GameOver);
-                _audios.push_back(GAME_OVER_AUDIO);
+            if (pickup.type == Pickup::Health) {
+                heal += 10;
             }
-            else {
-                _audios.push_back(LOSE_HP_AUDIO);
+            else if (pickup.type == Pickup::ThreeSixtyShots) {
+                collected360 = true;
             }
+            
+            _scene.Commands().DestroyEntity(entity);
         }
+    }, GetComponentMask<Pickup, Physics, Transform>());
+    
+    if (collected360) {
+        threeSixtyShots = true;
+        threeSixtyShotsEndTime = time + 7.5f;
+        _audios.push_back(POWER_UP_AUDIO);
     }
     
-    hpField.SetValue(_scene.Get<HP>(player).Get());
+    _scene.Get<HP>(player).Increase(heal);
     
-    {
-        auto& playerTf = _scene.Get<Transform>(player);
-        auto& playerPhysics = _scene.Get<Physics>(player);
-        
-        std::atomic<int> heal = 0;
-        std::atomic<bool> collected360 = false;
+    if (heal > 0) {
+        _audios.push_back(COLLECT_HP_AUDIO);
+    }
+}
+
+void NeonScene::FindHits() {
+    // Only read here, HitEnemies marks the enemies and projectiles it hits as changed
+    auto projectiles = _scene.GetGroup<Transform, Physics, PlayerProjectile>()->ReadMembers();
+    auto enemies = _scene.GetGroup<Transform, Physics, Enemy, HP, Mesh>()->ReadMembers();
+    
+    _enemyPositions.clear();
+    _enemyRadii.clear();
+    
+    for (auto& enemy : enemies) {
+        const float3 position = std::get<2>(enemy).position;
+        _enemyPositions.push_back(float2{position.x, position.y});
+        _enemyRadii.push_back(std::get<2>(enemy).GetScaledCollisionRadius(std::get<1>(enemy)));
+    }
+    
+    _enemyGrid.Build(_enemyPositions, _enemyRadii);
+    
+    _hitCandidates.resize(ThreadPool::ThreadCount() + 1);
+    for (auto& candidates : _hitCandidates) {
+        candidates.clear();
+    }
+    
+    // Chunks cover ascending projectile ranges, so reading the chunks in order gives the candidates
+    // ordered by projectile and, with each projectile's sorted, by time and then enemy
+    ThreadPool::GetInstance().ParallelFor(0, projectiles.size(), 64, [&](size_t chunkIdx, size_t begin, size_t end) {
+        auto& candidates = _hitCandidates[chunkIdx];
         
-        _scene.GetGroup<Pickup, Physics, Transform>()->UpdateParallel([&, this](auto entity,
-                                                                                auto& pickup,
-                                                                                auto& physics,
-                                                                                auto& tf) {
-            if (Physics::Overlapping(playerPhysics, physics, playerTf, tf, 0.1f)) {
+        for (size_t p = begin; p < end; p++) {
+            auto& projectileTf = std::get<1>(projectiles[p]);
+            auto& projectilePhysics = std::get<2>(projectiles[p]);
+            
+            const float3 position = projectilePhysics.position;
+            const float radius = projectilePhysics.GetScaledCollisionRadius(projectileTf);
+            const size_t firstCandidate = candidates.size();
+            
+            if (continuousCollision) {
+                // Enemies are tested where they are now, only the projectile's movement is swept
+                const float3 start = projectilePhysics.prevPosition;
                 
-                if (pickup.type == Pickup::Health) {
-                    heal += 10;
-                }
-                else if (pickup.type == Pickup::ThreeSixtyShots) {
-                    collected360 = true;
-                }
+                const float2 sweepMin = {std::min(start.x, position.x) - radius, std::min(start.y, position.y) - radius};
+                const float2 sweepMax = {std::max(start.x, position.x) + radius, std::max(start.y, position.y) + radius};
                 
-                _scene.DestroyEntity(entity);
+                _enemyGrid.QueryAABB(sweepMin, sweepMax, [&](uint32_t e) {
+                    auto time = Physics::SweptHitTime(projectilePhysics, std::get<2>(enemies[e]), projectileTf, std::get<1>(enemies[e]));
+                    if (time) {
+                        candidates.push_back(HitCandidate{static_cast<uint32_t>(p), *time, e});
+                    }
+                });
             }
-        });
-        
-        if (collected360) {
-            threeSixtyShots = true;
-            threeSixtyShotsEndTime = time + 7.5f;
-            _audios.push_back(POWER_UP_AUDIO);
-        }
-        
-        _scene.Get<HP>(player).Increase(heal);
-        
-        if (heal > 0) {
-            _audios.push_back(COLLECT_HP_AUDIO);
+            else {
+                _enemyGrid.QueryRadius(float2{position.x, position.y}, radius, [&](uint32_t e) {
+                    if (Physics::Overlapping(projectilePhysics, std::get<2>(enemies[e]), projectileTf, std::get<1>(enemies[e]))) {
+                        candidates.push_back(HitCandidate{static_cast<uint32_t>(p), 0, e});
+                    }
+                });
+            }
+            
+            std::sort(candidates.begin() + firstCandidate, candidates.end());
         }
-    }
-    
-    _scene.GetGroup<Transform, Physics, PlayerProjectile>()->Update([&, t = time](auto projectileEntity,
-                                                                                  auto& projectileTf,
-                                                                                  auto& projectilePhysics,
-                                                                                  auto& projectile) {
-        std::atomic<bool> didHit = false;
-        _scene.GetGroup<Transform, Physics, Enemy, HP, Mesh>()->UpdateParallel([&](auto enemyEntity,
-                                                                                   auto& enemyTf,
-                                                                                   auto& enemyPhysics,
-                                                                                   auto& enemy,
-                                                                                   auto& enemyHP,
-                                                                                   auto& enemyMesh) {
-            if (Physics::Overlapping(projectilePhysics, enemyPhysics, projectileTf, enemyTf)) {
+    });
+}
+
+void NeonScene::HitEnemies(double time) {
+    // Nothing is created or destroyed between FindHits and here, so the members are indexed like the candidates
+    auto projectiles = _scene.GetGroup<Transform, Physics, PlayerProjectile>()->ReadMembers();
+    auto enemies = _scene.GetGroup<Transform, Physics, Enemy, HP, Mesh>()->ReadMembers();
+    assert(enemies.size() == _enemyPositions.size() && "Members must not change after FindHits");
+    
+    // Each projectile hits the first enemy on its way that is still alive after the damage
+    // from the projectiles before it, as if the projectiles were applied one by one
+    std::vector<bool> didHit(projectiles.size(), false);
+    
+    for (auto& candidates : _hitCandidates) {
+        for (auto [p, time, e] : candidates) {
+            auto& enemyHP = std::get<4>(enemies[e]);
+            
+            if (didHit[p] || enemyHP.Get() <= 0) {
+                continue;
+            }
+            
+            didHit[p] = true;
+            
+            auto& projectile = std::get<3>(projectiles[p]);
+            const auto enemyEntity = std::get<0>(enemies[e]);
+            
+            if (enemyEntity != projectile.hit) {
+                enemyHP.Decrease(projectile.damage);
                 
-                if (enemyHP.Get() > 0 && !didHit.exchange(true) && enemyEntity != projectile.hit) {
-                    enemyHP.Decrease(projectile.damage);
-                    enemyMesh.tint.x = std::clamp(enemyMesh.tint.x - 0.25f * projectile.damage, 0.0f, 1.0f);
-                    projectile.hit = enemyEntity;
-                    if (enemy.blocksPiercing) {
-                        projectile.destructsOnCollision = true;
-                    }
+                auto& enemyMesh = std::get<5>(enemies[e]);
+                enemyMesh.tint.x = std::clamp(enemyMesh.tint.x - 0.25f * projectile.damage, 0.0f, 1.0f);
+                
+                projectile.hit = enemyEntity;
+                if (std::get<3>(enemies[e]).blocksPiercing) {
+                    projectile.destructsOnCollision = true;
                 }
+                
+                _scene.MarkChanged<HP>(enemyEntity);
+                _scene.MarkChanged<Mesh>(enemyEntity);
+                _scene.MarkChanged<PlayerProjectile>(std::get<0>(projectiles[p]));
             }
-        });
-        
-        if ((didHit && projectile.destructsOnCollision) || projectile.despawnTime < t) {
-            _scene.DestroyEntity(projectileEntity);
         }
-    });
+    }
     
+    for (size_t p = 0; p < projectiles.size(); p++) {
+        auto& projectile = std::get<3>(projectiles[p]);
+        
+        if ((didHit[p] && projectile.destructsOnCollision) || projectile.despawnTime < time) {
+            _scene.Commands().DestroyEntity(std::get<0>(projectiles[p]));
+        }
+    }
     
+    // Also destroys the pickups CollectPickups collected
+    _scene.FlushCommands();
+}
+
+void NeonScene::DestroyDeadEnemies() {
     int entitiesDestroyed = 0;
-    _scene.GetGroup<HP, Transform, Enemy>()->Update([&](auto entity,
-                                                        auto& hp,
-                                                        auto& tf,
-                                                        auto& enemy) {
+    // The simulated position, the transforms of culled enemies are not interpolated
+    _scene.GetGroup<HP, Physics, Enemy>()->Update([&](auto entity,
+                                                      auto& hp,
+                                                      auto& physics,
+                                                      auto& enemy) {
         if (hp.Get() < 1) {
-            float3 pos = tf.position;
-            _scene.DestroyEntity(entity);
+            float3 pos = physics.position;
+            _scene.Commands().DestroyEntity(entity);
             entitiesDestroyed++;
             _destroyedSincePickup++;
             if (_destroyedSincePickup > 29) {
@@ -657,44 +857,119 @@ void NeonScene::Tick(double time) {
         }
     });
     
+    _scene.FlushCommands();
+    
     if (entitiesDestroyed > 0) {
         _audios.push_back(EXPLOSION_AUDIO);
     }
     
     enemiesRemainingField.SetValue(enemiesRemainingField.GetValue() - entitiesDestroyed);
-    
+}
+
+void NeonScene::IntegratePhysics() {
+#ifdef NEON_ARCHETYPE_STORAGE
     _scene.GetGroup<Transform, Physics>()->UpdateParallel([timestep = _timestep](auto entity, auto& tf, auto& physics) {
         Physics::Update(physics, tf, timestep);
     });
+#else
+    // Physics::Update over the owning group's columns: teleports and set rotations first,
+    // then the kernels integrate every body one axis at a time
+    _scene.GetOwningGroup<Transform, Physics>()->UpdateColumnsParallel([timestep = static_cast<float>(_timestep)](size_t begin,
+                                                                                                                  size_t end,
+                                                                                                                  TransformColumns& tf,
+                                                                                                                  PhysicsColumns& physics) {
+        for (size_t i = begin; i < end; i++) {
+            if (tf.At<&Transform::teleported>(i)) {
+                physics.At<&Physics::position>(i) = tf.At<&Transform::position>(i);
+                tf.At<&Transform::teleported>(i) = false;
+            }
+            
+            if (tf.At<&Transform::rotationSet>(i)) {
+                physics.At<&Physics::rotation>(i) = tf.At<&Transform::rotation>(i);
+                tf.At<&Transform::rotationSet>(i) = false;
+            }
+        }
+        
+        auto Integrate = [&](SoAColumn<float3>& values, SoAColumn<float3>& previous, SoAColumn<float3>& rates) {
+            IntegrateArray(values.X() + begin, previous.X() + begin, rates.X() + begin, timestep, end - begin);
+            IntegrateArray(values.Y() + begin, previous.Y() + begin, rates.Y() + begin, timestep, end - begin);
+            IntegrateArray(values.Z() + begin, previous.Z() + begin, rates.Z() + begin, timestep, end - begin);
+        };
+        
+        Integrate(physics.Column<&Physics::position>(), physics.Column<&Physics::prevPosition>(), physics.Column<&Physics::velocity>());
+        Integrate(physics.Column<&Physics::rotation>(), physics.Column<&Physics::prevRotation>(), physics.Column<&Physics::angularVelocity>());
+    });
+#endif
+}
+
+void NeonScene::SeparateBodies() {
+    // Transform is only read, Physics is marked as changed for the bodies that are moved
+    auto physicsBodies = _scene.GetGroup<Transform, Physics>(GetComponentMask<PlayerProjectile>())->ReadMembers();
+    const size_t bodyCount = physicsBodies.size();
+    
+    _bodyPositions.resize(bodyCount);
+    _bodyRadii.resize(bodyCount);
+    _bodyDisplacements.resize(bodyCount);
+    
+    for (size_t i = 0; i < bodyCount; i++) {
+        auto& physics = std::get<2>(physicsBodies[i]);
+        _bodyPositions[i] = float2{physics.position.x, physics.position.y};
+        _bodyRadii[i] = physics.GetScaledCollisionRadius(std::get<1>(physicsBodies[i]));
+    }
     
+    auto& threadPool = ThreadPool::GetInstance();
+    constexpr size_t minBodiesPerJob = 64;
     
-    auto physicsBodies = _scene.GetGroup<Transform, Physics>(GetComponentMask<PlayerProjectile>())->GetMembers();
-    for (size_t i = 0; i < physicsBodies.size(); i++) {
-        for (size_t j = i + 1; j < physicsBodies.size(); j++) {
-            Transform& tfA = std::get<1>(physicsBodies[i]);
-            Transform& tfB = std::get<1>(physicsBodies[j]);
-            
-            Physics& physicsA = std::get<2>(physicsBodies[i]);
-            Physics& physicsB = std::get<2>(physicsBodies[j]);
-            
-            float3 aToB = physicsB.position - physicsA.position;
-            aToB.z = 0;
-            
-            float dist = VecLength(aToB);
-            float overlap = physicsA.GetScaledCollisionRadius(tfA) + physicsB.GetScaledCollisionRadius(tfB) - dist;
-            
-            if (overlap > 0) {
-                physicsA.position -= aToB * overlap;
-                physicsB.position += aToB * overlap;
+    for (int iteration = 0; iteration < separationIterations; iteration++) {
+        _bodyGrid.Build(_bodyPositions, _bodyRadii);
+        
+        // Each body sums the pushes from its overlapping neighbours, reading only positions from the start
+        // of the iteration. Neighbours are visited in the grid's order, so the sums do not depend on the chunks.
+        threadPool.ParallelFor(0, bodyCount, minBodiesPerJob, [&](size_t chunkIdx, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                const float2 position = _bodyPositions[i];
+                const float radius = _bodyRadii[i];
+                
+                float2 displacement = {0, 0};
+                
+                _bodyGrid.QueryRadius(position, radius, [&](uint32_t j) {
+                    if (j == i) {
+                        return;
+                    }
+                    
+                    const float2 toNeighbour = _bodyPositions[j] - position;
+                    const float overlap = radius + _bodyRadii[j] - VecLength(toNeighbour);
+                    
+                    if (overlap > 0) {
+                        displacement -= toNeighbour * overlap;
+                    }
+                });
+                
+                _bodyDisplacements[i] = displacement;
             }
-            
+        });
+        
+        for (size_t i = 0; i < bodyCount; i++) {
+            _bodyPositions[i] += _bodyDisplacements[i];
         }
     }
     
+    threadPool.ParallelFor(0, bodyCount, minBodiesPerJob, [&](size_t chunkIdx, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            auto& physics = std::get<2>(physicsBodies[i]);
+            
+            if (physics.position.x != _bodyPositions[i].x || physics.position.y != _bodyPositions[i].y) {
+                physics.position.x = _bodyPositions[i].x;
+                physics.position.y = _bodyPositions[i].y;
+                _scene.MarkChanged<Physics>(std::get<0>(physicsBodies[i]));
+            }
+        }
+    });
 }
 
 float3 NeonScene::CameraPosition() {
-    auto& camera = _scene.Get<Camera>(cam);
+    // Measured on a copy so the scene camera only changes when it actually moves
+    auto camera = _scene.Get<Camera>(cam);
     camera.SetPosition({0.0f, 0.0f, -camDistance});
     float3 topRightPos = camera.ScreenPointToWorld({1.0f, 1.0f}, 0);
     float hWidth = topRightPos.x;
@@ -720,28 +995,24 @@ void NeonScene::Render(double time, double dt) {
     float spreadScale = 0.5f + weapons[weaponIdx].spread * 10 * (interpolatedSpreadMult - 0.5f);
     _scene.Get<Transform>(spreadCircle).scale = float3{spreadScale, spreadScale, spreadScale};
     
-    _scene.GetGroup<Transform, Physics>()->UpdateParallel([interpolation](auto entity,
-                                                                          auto& tf,
-                                                                          auto& physics) {
-        if (!tf.teleported) {
-            tf.position = physics.GetInterpolatedPosition(interpolation);
+    // The camera follows the player, the other bodies are culled against its view before they are placed
+    Interpolate(_scene.Get<Transform>(player), _scene.Get<Physics>(player), interpolation);
+    _scene.Get<Camera>(cam).SetPosition(CameraPosition());
+    
+    PlaceBodies(interpolation);
+    
+    _scene.GetGroup<Transform, Enemy>()->Update([this](auto entity,
+                                                       auto& tf,
+                                                       auto& enemy) {
+        if (_renderBuckets.IsCulled(entity)) {
+            return;
         }
         
-        if (!tf.rotationSet) {
-            tf.rotation = physics.GetInterpolatedRotation(interpolation);
-        }
-    });
-    
-    _scene.GetGroup<Transform, Enemy>()->Update([](auto entity,
-                                                   auto& tf,
-                                                   auto& enemy) {
         float angle = tf.rotation.y * DegToRad;
         float minY = std::abs(std::sin(angle)) + std::abs(std::cos(angle));
         tf.position.z *= minY;
     });
     
-    _scene.Get<Camera>(cam).SetPosition(CameraPosition());
-    
     {
         float3 crosshairPos = _scene.Get<Camera>(cam).ScreenPointToWorld(mousePos, 0);
         _scene.Get<Transform>(crosshair).position = crosshairPos;
@@ -750,27 +1021,102 @@ void NeonScene::Render(double time, double dt) {
     
     RenderUI();
     
-    _scene.GetGroup<Mesh, HP>()->UpdateParallel([dt](auto entity,
-                                                     auto& mesh,
-                                                     auto& hp) {
+    _scene.GetGroup<Mesh, HP>()->UpdateParallel<Changed<Mesh, HP>>([this, dt](auto entity,
+                                                                           auto& mesh,
+                                                                           auto& hp) {
         float tint = std::min(mesh.tint.x + static_cast<float>(dt) * 0.5f, std::abs(static_cast<float>(hp.Get()) / hp.Max()));
-        mesh.tint = float4{tint, tint, tint, 1};
+        
+        // Fading back after a hit, visited again next frame until the tint settles
+        if (tint != mesh.tint.x || tint != mesh.tint.y || tint != mesh.tint.z || mesh.tint.w != 1) {
+            mesh.tint = float4{tint, tint, tint, 1};
+            _scene.MarkChanged<Mesh>(entity);
+        }
     });
+}
+
+void NeonScene::UpdateRenderBuckets() {
+    _scene.NotifyObservers();
+    _scene.GetGroup<Mesh>()->Update<Changed<Mesh>>([this](auto entity, auto& mesh) {
+        _renderBuckets.Update(entity, mesh);
+    });
+}
+
+void NeonScene::PlaceBodies(double interpolation) {
+    // Bodies spawned by this frame's ticks are bucketed first, so they are culled from their first frame
+    UpdateRenderBuckets();
+    
+    auto& camera = _scene.Get<Camera>(cam);
+    const Frustum frustum(camera.GetProjectionMatrix() * camera.GetViewMatrix());
     
-    _scene.GetGroup<Transform, Mesh>()->UpdateParallel([](auto entity,
-                                                          auto& tf,
-                                                          auto& mesh) {
-        float4x4 S = ScaleMatrix(tf.scale);
-        float4x4 T = TranslationMatrix(tf.position);
+    // Bodies that are not drawn are never culled. Render lifts tilted enemies by up to sqrt(2) times
+    // their height after placing them.
+    auto CullRadius = [this](Entity entity, float3 scale, float height) {
+        const auto* bucket = _renderBuckets.Find(entity);
+        
+        if (bucket == nullptr) {
+            return std::numeric_limits<float>::infinity();
+        }
+        
+        const float meshRadius = meshRadii[bucket->key.mesh] * std::max({std::abs(scale.x), std::abs(scale.y), std::abs(scale.z)});
+        return meshRadius + std::abs(height) * (std::numbers::sqrt2_v<float> - 1);
+    };
+
+#ifdef NEON_ARCHETYPE_STORAGE
+    _scene.GetGroup<Transform, Physics>()->UpdateParallel([&](auto entity, auto& tf, auto& physics) {
+        bool culled;
+        
+        // Teleported bodies are drawn where gameplay put them, the others somewhere on their way
+        if (tf.teleported) {
+            culled = !frustum.Intersects(tf.position, CullRadius(entity, tf.scale, tf.position.z));
+        }
+        else {
+            const float height = std::max(std::abs(physics.prevPosition.z), std::abs(physics.position.z));
+            culled = !frustum.IntersectsSweep(physics.prevPosition, physics.position, CullRadius(entity, tf.scale, height));
+        }
+        
+        _renderBuckets.SetCulled(entity, culled);
+        
+        if (!culled) {
+            Interpolate(tf, physics, interpolation);
+        }
+    });
+#else
+    // The kernel culls the spheres swept from the previous to the current positions a chunk at a time
+    auto bodies = _scene.GetOwningGroup<Transform, Physics>();
+    _cullRadii.resize(bodies->Size());
+    _culledBodies.resize(bodies->Size());
+    
+    bodies->UpdateColumnsParallel([&](size_t begin, size_t end, TransformColumns& tf, PhysicsColumns& physics) {
+        const auto& entities = bodies->GetEntities();
+        auto& scale = tf.Column<&Transform::scale>();
+        auto& prevPosition = physics.Column<&Physics::prevPosition>();
+        auto& position = physics.Column<&Physics::position>();
         
-        float4x4 rX = RotationMatrix(xAxis, tf.rotation.x);
-        float4x4 rY = RotationMatrix(yAxis, tf.rotation.y);
-        float4x4 rZ = RotationMatrix(zAxis, tf.rotation.z);
+        for (size_t i = begin; i < end; i++) {
+            const float height = std::max(std::abs(prevPosition.Z()[i]), std::abs(position.Z()[i]));
+            _cullRadii[i] = CullRadius(entities[i], {scale.X()[i], scale.Y()[i], scale.Z()[i]}, height);
+        }
         
-        float4x4 R = rZ * rY * rX;
+        CullSweptSpheres(frustum,
+                         {prevPosition.X() + begin, prevPosition.Y() + begin, prevPosition.Z() + begin,
+                          position.X() + begin, position.Y() + begin, position.Z() + begin,
+                          _cullRadii.data() + begin, end - begin},
+                         _culledBodies.data() + begin);
         
-        mesh.modelMatrix =  T * R * S;
+        for (size_t i = begin; i < end; i++) {
+            if (tf.At<&Transform::teleported>(i)) {
+                const float3 teleportPosition = tf.At<&Transform::position>(i);
+                _culledBodies[i] = !frustum.Intersects(teleportPosition, CullRadius(entities[i], tf.At<&Transform::scale>(i), teleportPosition.z));
+            }
+            
+            _renderBuckets.SetCulled(entities[i], _culledBodies[i]);
+            
+            if (!_culledBodies[i]) {
+                Interpolate(TransformRef(tf, i), PhysicsRef(physics, i), interpolation);
+            }
+        }
     });
+#endif
 }
 
 void NeonScene::RenderUI() {
@@ -785,11 +1131,18 @@ void NeonScene::RenderUI() {
     UpdateField(waveField);
     UpdateField(enemiesRemainingField);
     
-    _scene.GetGroup<Transform, Anchor>()->UpdateParallel([&camera](auto entity,
-                                                                   auto& tf,
-                                                                   auto& anchor) {
+    auto UpdateAnchor = [&camera](auto entity, auto& tf, auto& anchor) {
         tf.position = camera.ScreenPointToWorld(anchor.screenPosition, 0) + anchor.margin;
-    });
+    };
+    
+    // Every anchored position depends on the camera
+    if (camera.GetVersion() != _anchorCameraVersion) {
+        _scene.GetGroup<Transform, Anchor>()->UpdateParallel(UpdateAnchor);
+        _anchorCameraVersion = camera.GetVersion();
+    }
+    else {
+        _scene.GetGroup<Transform, Anchor>()->UpdateParallel<Changed<Anchor>>(UpdateAnchor);
+    }
     
     
     float3 mPos = camera.ScreenPointToWorld(mousePos, 0);
@@ -886,6 +1239,20 @@ void NeonScene::UpdateField(const NumberField& field, float2 extraMargin) {
 
 
 FrameData NeonScene::GetFrameData() {
+    return GetFrameData(_instances.data(), _instances.size());
+}
+
+FrameData NeonScene::GetFrameData(Instance* instances, size_t capacity) {
+    return ComposeFrameData(instances, nullptr, capacity);
+}
+
+FrameData NeonScene::GetFrameData(CompactInstance* instances, size_t capacity) {
+    return ComposeFrameData(nullptr, instances, capacity);
+}
+
+FrameData NeonScene::ComposeFrameData(Instance* instances, CompactInstance* compactInstances, size_t capacity) {
+    assert((instances == nullptr) != (compactInstances == nullptr) && "Instances are written in one format");
+    
     GlobalUniforms uniforms;
     uniforms.projMatrix = _scene.Get<Camera>(cam).GetProjectionMatrix();
     uniforms.viewMatrix = _scene.Get<Camera>(cam).GetViewMatrix();
@@ -903,54 +1270,101 @@ FrameData NeonScene::GetFrameData() {
     _groupMeshes.clear();
     _groupTextures.clear();
     _groupShaders.clear();
-    _instances.clear();
-    auto meshPool = _scene.GetPool<Mesh>();
-    meshPool->Sort();
-    
-    if (meshPool->size() > 0) {
-        const Mesh& firstMesh = (*meshPool)[0];
-        auto prevMat = firstMesh.material;
-        auto prevType = firstMesh.type;
-        
-        _groupSizes.push_back(0);
-        _groupMeshes.push_back(prevType);
-        _groupTextures.push_back(prevMat.texture);
-        _groupShaders.push_back(prevMat.shader);
-        size_t groupIdx = 0;
-        for (auto& mesh : *meshPool) {
-            if (mesh.hidden) {
-                continue;;
-            }
-            
-            Instance instance;
-            instance.transform = mesh.modelMatrix;
+    
+    // Meshes changed later in the frame, such as fading tints and hidden UI, are drawn as they are now
+    UpdateRenderBuckets();
 
-#ifdef _WIN64
-            XMStoreFloat4x4(&instance.transform, XMMatrixTranspose(XMLoadFloat4x4(&instance.transform)));
+#ifdef NEON_ARCHETYPE_STORAGE
+    auto TransformOf = [this](Entity entity) -> const Transform& { return _scene.Get<Transform>(entity); };
+    auto MeshOf = [this](Entity entity) -> const Mesh& { return _scene.Get<Mesh>(entity); };
+#else
+    // Read through the pools, Get would stamp every mesh as changed and revisit it next frame
+    auto transformPool = _scene.GetPool<Transform>();
+    auto meshPool = _scene.GetPool<Mesh>();
+    auto TransformOf = [&transformPool](Entity entity) { return transformPool->GetComponent(entity.id); };
+    auto MeshOf = [&meshPool](Entity entity) -> const Mesh& { return meshPool->GetComponent(entity.id); };
 #endif
-
-            instance.color = mesh.material.color * mesh.tint;
-            _instances.emplace_back(instance);
+    
+    InstanceBlock block = {};
+    size_t blockCount = 0;
+    size_t instanceCount = 0;
+    size_t culledCount = 0;
+    size_t droppedCount = 0;
+    
+    // Gathered a block at a time for the kernel, which writes the instances in place
+    auto ComposeBlock = [&]() {
+        if (compactInstances != nullptr) {
+            ComposeCompactInstances(block, blockCount, compactInstances + instanceCount);
+        }
+        else {
+            ComposeInstances(block, blockCount, instances + instanceCount);
+        }
+        
+        instanceCount += blockCount;
+        blockCount = 0;
+    };
+    
+    for (auto& [key, bucket] : _renderBuckets.GetBuckets()) {
+        const size_t groupBegin = instanceCount;
+        
+        for (size_t i = 0; i < bucket.entities.size(); i++) {
+            if (bucket.culled[i]) {
+                culledCount++;
+                continue;
+            }
             
-            auto type = mesh.type;
-            auto mat = mesh.material;
-            if (type != prevType || mat != prevMat) {
-                _groupSizes.push_back(0);
-                _groupMeshes.push_back(type);
-                _groupTextures.push_back(mat.texture);
-                _groupShaders.push_back(mat.shader);
-                prevMat = mat;
-                prevType = type;
-                groupIdx++;
+            // Once the destination is full the rest of the frame is dropped, across all buckets
+            if (instanceCount + blockCount == capacity) {
+                droppedCount++;
+                continue;
             }
             
-            _groupSizes[groupIdx]++;
+            const auto& tf = TransformOf(bucket.entities[i]);
+            const Mesh& mesh = MeshOf(bucket.entities[i]);
+            
+            block.positionX[blockCount] = tf.position.x;
+            block.positionY[blockCount] = tf.position.y;
+            block.positionZ[blockCount] = tf.position.z;
+            block.rotationX[blockCount] = tf.rotation.x;
+            block.rotationY[blockCount] = tf.rotation.y;
+            block.rotationZ[blockCount] = tf.rotation.z;
+            block.scaleX[blockCount] = tf.scale.x;
+            block.scaleY[blockCount] = tf.scale.y;
+            block.scaleZ[blockCount] = tf.scale.z;
+            
+            block.colorR[blockCount] = mesh.material.color.x;
+            block.colorG[blockCount] = mesh.material.color.y;
+            block.colorB[blockCount] = mesh.material.color.z;
+            block.colorA[blockCount] = mesh.material.color.w;
+            block.tintR[blockCount] = mesh.tint.x;
+            block.tintG[blockCount] = mesh.tint.y;
+            block.tintB[blockCount] = mesh.tint.z;
+            block.tintA[blockCount] = mesh.tint.w;
+            
+            if (++blockCount == InstanceBlock::capacity) {
+                ComposeBlock();
+            }
+        }
+        
+        if (blockCount > 0) {
+            ComposeBlock();
+        }
+        
+        if (instanceCount == groupBegin) {
+            continue;
         }
+        
+        _groupSizes.push_back(instanceCount - groupBegin);
+        _groupMeshes.push_back(key.mesh);
+        _groupTextures.push_back(key.texture);
+        _groupShaders.push_back(key.shader);
     }
     
-    assert(_instances.size() < MAX_INSTANCE_COUNT && "Number of instances must be less than MAX_ENTITY_COUNT");
-    frameData.instanceCount = _instances.size();
-    frameData.instances = _instances.data();
+    frameData.instanceCount = instanceCount;
+    frameData.instances = instances;
+    frameData.compactInstances = compactInstances;
+    frameData.culledCount = culledCount;
+    frameData.droppedCount = droppedCount;
     
     frameData.groupCount = static_cast<uint32_t>(_groupSizes.size());
     frameData.groupSizes = _groupSizes.data();
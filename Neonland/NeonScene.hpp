@@ -3,7 +3,6 @@
 #include <array>
 #include <random>
 
-#include "./Engine/Scene.hpp"
 #include "./Engine/GameClock.hpp"
 #include "NeonConstants.h"
 
@@ -17,9 +16,24 @@
 #include "Weapon.hpp"
 
 #include "./Engine/FrameData.h"
+#include "./Engine/SystemScheduler.hpp"
+#include "./Engine/SpatialHashGrid.hpp"
+#include "RenderBuckets.hpp"
 #include "NumberField.hpp"
 #include "Level.hpp"
 #include "GameState.hpp"
+#include "Resources.hpp"
+
+// Define NEON_ARCHETYPE_STORAGE to run the game on the chunked archetype storage backend. The Archetype
+// configuration in Xcode defines it, and so does building the Visual Studio project with
+// /p:NeonArchetypeStorage=true.
+#ifdef NEON_ARCHETYPE_STORAGE
+#include "./Engine/ArchetypeScene.hpp"
+using GameScene = ArchetypeScene;
+#else
+#include "./Engine/Scene.hpp"
+using GameScene = Scene;
+#endif
 
 class NeonScene {
 public:
@@ -38,7 +52,14 @@ public:
     float2 directionalInput = {0, 0};
     
     int weaponIdx = 0;
-
+    
+    // Solver iterations of the body separation per tick. More iterations make crowds stiffer.
+    int separationIterations = 1;
+    
+    // Tests projectiles along their movement during the last tick instead of only where they ended,
+    // so fast projectiles cannot pass through enemies at low tick rates
+    bool continuousCollision = true;
+    
     std::wstring saveFilePath = L"";
     
     NeonScene(size_t maxInstanceCount, double timestep);
@@ -55,6 +76,10 @@ public:
     void Update(float aspectRatio);
     
     FrameData GetFrameData();
+    // Writes the instances to instances, which has room for capacity of them, instead of an internal buffer
+    FrameData GetFrameData(Instance* instances, size_t capacity);
+    // Like the above in the compact format, frameData.compactInstances points to instances
+    FrameData GetFrameData(CompactInstance* instances, size_t capacity);
     
     double Timestep() const;
     size_t MaxInstanceCount() const;
@@ -69,8 +94,11 @@ public:
     
     Entity CreateButton(float2 screenPos, float scale, TextureType tex, std::function<void()> action);
     Entity CreateImage(float2 screenPos, float scale, TextureType tex);
+    
+    // The tick systems with their dependencies, for inspecting the schedule
+    std::string DumpTickSchedule() const;
 private:
-    Scene _scene;
+    GameScene _scene;
     GameClock _clock;
     
     float3 moveDir = {0, 0, 0};
@@ -97,12 +125,51 @@ private:
     float camDistance = 25;
     float camTilt = 0;
     
+    // Camera version the anchored UI was last positioned for
+    uint32_t _anchorCameraVersion = 0;
+    
     int _destroyedSincePickup = 0;
     
+    SystemScheduler _tickSystems;
+    
+    // Time of the tick being run, read by the tick systems
+    double _tickTime = 0;
+    
+    // Bodies that are separated, indexed like the members of their group. Rebuilt each iteration.
+    SpatialHashGrid _bodyGrid;
+    std::vector<float2> _bodyPositions;
+    std::vector<float> _bodyRadii;
+    std::vector<float2> _bodyDisplacements;
+    
+    // Scaled radii of the bodies and the ones touching the player, indexed like the members of their group
+    std::vector<float> _touchRadii;
+    std::vector<uint32_t> _touchingBodies;
+    
+    // Bounding radii of the bodies and whether they are outside the view, indexed like the members of their group
+    std::vector<float> _cullRadii;
+    std::vector<uint8_t> _culledBodies;
+    
+    // Enemies projectiles are tested against, indexed like the members of their group. Rebuilt each tick.
+    SpatialHashGrid _enemyGrid;
+    std::vector<float2> _enemyPositions;
+    std::vector<float> _enemyRadii;
+    
+    struct HitCandidate {
+        uint32_t projectile;
+        // Fraction of the projectile's movement at which it reaches the enemy
+        float time;
+        uint32_t enemy;
+        
+        auto operator<=>(const HitCandidate&) const = default;
+    };
+    
+    // Overlapping projectiles and enemies, by member index, found by each chunk of FindHits
+    std::vector<std::vector<HitCandidate>> _hitCandidates;
+    
     int levelIdx = 0;
     
     int _unlockLevel = 0;
-
+    
     GameState _gameState = GameState::Menu;
     
     int currentWave = 0;
@@ -111,6 +178,8 @@ private:
     
     std::default_random_engine randomEngine;
     
+    RenderBuckets _renderBuckets;
+    
     std::vector<Instance> _instances;
     std::vector<size_t> _groupSizes;
     std::vector<uint32_t> _groupMeshes;
@@ -165,7 +234,8 @@ private:
     
     void SetGameState(GameState state);
     
-    Entity CreatePickup(float3 pos);
+    // Recorded into the scene's command buffer, created on the next flush
+    void CreatePickup(float3 pos);
     
     void LoadLevel(int i);
     
@@ -173,7 +243,33 @@ private:
     
     void SpawnSubWave(const Wave::SubWave& subWave);
     
+    void RegisterTickSystems();
+    
+    // Tick systems
+    void SteerEnemies(double time);
+    void ClampPlayer();
+    void FireWeapon(double time);
+    void AttackPlayer(double time);
+    void CollectPickups(double time);
+    void FindHits();
+    void HitEnemies(double time);
+    void DestroyDeadEnemies();
+    void IntegratePhysics();
+    void SeparateBodies();
+    
     void Tick(double time);
     void Render(double time, double dt);
     void RenderUI();
+    
+    // Writes the instances to exactly one of instances and compactInstances
+    FrameData ComposeFrameData(Instance* instances, CompactInstance* compactInstances, size_t capacity);
+    
+    // Sorts meshes added, removed or changed since the last call into their buckets
+    void UpdateRenderBuckets();
+    
+    // Interpolates the bodies in the camera's view and marks the others culled, so they are not drawn
+    void PlaceBodies(double interpolation);
+    
+    // Drives Tick directly, see Engine/Benchmarks
+    friend class TickBenchmark;
 };
@@ -24,6 +24,18 @@ FrameData Neon_Render(float aspectRatio) {
     return scene.GetFrameData();
 }
 
+void Neon_RenderInto(float aspectRatio, Instance* dst, size_t capacity, FrameData* out) {
+    scene.Update(aspectRatio);
+    
+    *out = scene.GetFrameData(dst, capacity);
+}
+
+void Neon_RenderCompactInto(float aspectRatio, CompactInstance* dst, size_t capacity, FrameData* out) {
+    scene.Update(aspectRatio);
+    
+    *out = scene.GetFrameData(dst, capacity);
+}
+
 void Neon_UpdateCursorPosition(float x, float y) {
     scene.prevMousePos = scene.mousePos;
     
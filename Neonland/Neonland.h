@@ -26,6 +26,14 @@ void Neon_UpdateTextureSize(TextureType tex, TexSize size);
 
 void Neon_Start();
 FrameData Neon_Render(float aspectRatio);
+// Like Neon_Render, but writes the instances to dst, which has room for capacity of them.
+// out->instances points to dst, so a mapped GPU buffer can be passed without a further copy.
+// Meshes that do not fit are left out and counted in out->droppedCount.
+void Neon_RenderInto(float aspectRatio, Instance* dst, size_t capacity, FrameData* out);
+// Like Neon_RenderInto in the compact format, out->compactInstances points to dst and out->instances is null.
+// The Metal renderer uses it when NEON_COMPACT_INSTANCES is set, its Compact vertex functions decode
+// CompactInstance as DecodeCompactInstances in Engine/CompactInstance.hpp does.
+void Neon_RenderCompactInto(float aspectRatio, CompactInstance* dst, size_t capacity, FrameData* out);
 
 bool Neon_IsMusic(AudioType audio);
 
@@ -0,0 +1,79 @@
+#include "RenderBuckets.hpp"
+
+#include "./Components/Mesh.hpp"
+
+void RenderBuckets::Update(Entity entity, const Mesh& mesh) {
+    if (mesh.hidden) {
+        Remove(entity);
+        return;
+    }
+    
+    if (entity.id >= locations.size()) {
+        locations.resize(entity.id + 1);
+    }
+    
+    const Key key = {mesh.type, mesh.material.shader, mesh.material.texture};
+    
+    auto& location = locations[entity.id];
+    if (location.entity == entity && location.bucket != nullptr && location.bucket->key == key) {
+        return;
+    }
+    
+    // Also drops a destroyed entity whose id was reused before its removal was delivered
+    Take(entity.id);
+    
+    auto& bucket = buckets.try_emplace(key, Bucket{key, {}, {}}).first->second;
+    location = {entity, &bucket, bucket.entities.size()};
+    bucket.entities.push_back(entity);
+    bucket.culled.push_back(false);
+}
+
+void RenderBuckets::Remove(Entity entity) {
+    if (entity.id < locations.size() && locations[entity.id].entity == entity) {
+        Take(entity.id);
+    }
+}
+
+const std::map<RenderBuckets::Key, RenderBuckets::Bucket>& RenderBuckets::GetBuckets() const {
+    return buckets;
+}
+
+const RenderBuckets::Bucket* RenderBuckets::Find(Entity entity) const {
+    if (entity.id >= locations.size() || locations[entity.id].entity != entity) {
+        return nullptr;
+    }
+    
+    return locations[entity.id].bucket;
+}
+
+void RenderBuckets::SetCulled(Entity entity, bool culled) {
+    if (Find(entity) != nullptr) {
+        const auto& location = locations[entity.id];
+        location.bucket->culled[location.slot] = culled;
+    }
+}
+
+bool RenderBuckets::IsCulled(Entity entity) const {
+    const Bucket* bucket = Find(entity);
+    return bucket != nullptr && bucket->culled[locations[entity.id].slot];
+}
+
+void RenderBuckets::Take(Entity::Id id) {
+    auto& location = locations[id];
+    
+    if (location.bucket == nullptr) {
+        return;
+    }
+    
+    // The last entity of the bucket fills the hole
+    auto& entities = location.bucket->entities;
+    auto& culled = location.bucket->culled;
+    const Entity last = entities.back();
+    entities[location.slot] = last;
+    culled[location.slot] = culled.back();
+    locations[last.id].slot = location.slot;
+    entities.pop_back();
+    culled.pop_back();
+    
+    location.bucket = nullptr;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <cstdint>
+#include "./Engine/Entity.hpp"
+#include "NeonConstants.h"
+
+class Mesh;
+
+// Visible meshes grouped by what they are drawn with. Kept up to date as meshes are added,
+// removed, hidden or change type or material, so packing a frame is a walk over the buckets.
+class RenderBuckets {
+public:
+    struct Key {
+        MeshType mesh;
+        ShaderType shader;
+        TextureType texture;
+        
+        auto operator<=>(const Key& rhs) const = default;
+    };
+    
+    struct Bucket {
+        Key key;
+        std::vector<Entity> entities;
+        // Whether each entity is left out of the frame, indexed like entities. Entities start out drawn.
+        std::vector<uint8_t> culled;
+    };
+    
+    // Moves entity to the bucket of mesh, or takes it out of its bucket if mesh is hidden
+    void Update(Entity entity, const Mesh& mesh);
+    
+    // Takes entity out of its bucket. Entities that are not in a bucket are ignored.
+    void Remove(Entity entity);
+    
+    // Ordered by mesh type, shader and texture. Buckets are kept when they empty.
+    const std::map<Key, Bucket>& GetBuckets() const;
+    
+    // Bucket of entity, or null if it is not drawn
+    const Bucket* Find(Entity entity) const;
+    
+    // Records whether entity is left out of the frame. Entities that are not drawn are ignored.
+    // Safe to call in parallel for different entities.
+    void SetCulled(Entity entity, bool culled);
+    bool IsCulled(Entity entity) const;
+private:
+    struct Location {
+        Entity entity = Entity::NULL_ENTITY();
+        Bucket* bucket = nullptr;
+        size_t slot = 0;
+    };
+    
+    // Map nodes do not move, so locations can point at their buckets
+    std::map<Key, Bucket> buckets;
+    
+    // Indexed by entity id
+    std::vector<Location> locations;
+    
+    // Empties the location of id, whichever entity it belongs to
+    void Take(Entity::Id id);
+};
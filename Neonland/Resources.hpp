@@ -0,0 +1,21 @@
+#pragma once
+
+#include "./Engine/Resource.hpp"
+
+// NeonScene state the tick systems declare as Read or Write besides components
+namespace Resources {
+    // The sounds queued for the frame
+    struct Audio {
+        static constexpr ResourceType resourceType = ResourceType::audio;
+    };
+    
+    // The game state, the clock and the UI shown for the state
+    struct GameState {
+        static constexpr ResourceType resourceType = ResourceType::gameState;
+    };
+    
+    // The collected power ups and when they end
+    struct PowerUps {
+        static constexpr ResourceType resourceType = ResourceType::powerUps;
+    };
+}
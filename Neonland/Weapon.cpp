@@ -9,3 +9,8 @@ Weapon::Weapon(PlayerProjectile projectile, double cooldown, float spread, int p
 , projectileMesh{projectileMesh}
 , audio{audio}
 , cooldownEndTime{0} {}
+
+auto Weapon::MakeProjectilePrefab() const -> ProjectilePrefab {
+    auto tf = Transform(float3{0, 0, 0}, float3{0, 0, 0}, float3{1.0f, 0.5f, 0.5f} * projectileSize);
+    return ProjectilePrefab(Physics(tf), tf, projectileMesh, projectile);
+}
@@ -2,6 +2,11 @@
 
 #include "./Components/PlayerProjectile.hpp"
 #include "./Components/Mesh.hpp"
+#include "./Components/Physics.hpp"
+#include "./Components/Transform.hpp"
+#include "./Engine/Prefab.hpp"
+
+using ProjectilePrefab = Prefab<Physics, Transform, Mesh, PlayerProjectile>;
 
 class Weapon {
 public:
@@ -18,4 +23,7 @@ public:
     double cooldownEndTime;
     
     Weapon(PlayerProjectile projectile, double cooldown, float spread, int projectilesPerShot, float projectileSize, Mesh projectileMesh, AudioType audio);
+    
+    // Spawn position, rotation and velocity are set per instance
+    auto MakeProjectilePrefab() const -> ProjectilePrefab;
 };
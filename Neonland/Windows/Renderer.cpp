@@ -429,7 +429,11 @@ bool Renderer::Render() {
 	// Update
 	auto outputSize = _deviceResources->GetOutputSize();
 	float aspectRatio = outputSize.Width / outputSize.Height;
-	FrameData frameData = Neon_Render(aspectRatio);
+
+	// The instances are written straight into this frame's part of the mapped buffer
+	uint8_t* currentInstances = _mappedInstanceBuffer + (_deviceResources->GetCurrentFrameIndex() * AlignedInstanceBufferSize);
+	FrameData frameData;
+	Neon_RenderInto(aspectRatio, reinterpret_cast<Instance*>(currentInstances), MAX_INSTANCE_COUNT, &frameData);
 
 	auto& audioPlayer = AudioPlayer::Instance();
 	for (size_t i = 0; i < frameData.audioCount; i++)
@@ -441,9 +445,6 @@ bool Renderer::Render() {
 	uint8_t* currentGlobalUniforms = _mappedGlobalUniformsBuffer + (_deviceResources->GetCurrentFrameIndex() * AlignedGlobalUnformsBufferSize);
 	memcpy(currentGlobalUniforms, &frameData.globalUniforms, sizeof(frameData.globalUniforms));
 
-	uint8_t* currentInstances = _mappedInstanceBuffer + (_deviceResources->GetCurrentFrameIndex() * AlignedInstanceBufferSize);
-	memcpy(currentInstances, frameData.instances, frameData.instanceCount * sizeof(Instance));
-
 	// Prepare for rendering
 	winrt::check_hresult(_deviceResources->GetCommandAllocator()->Reset());
 	winrt::check_hresult(_commandList->Reset(_deviceResources->GetCommandAllocator(), _pipelineStates[LIT_SHADER].get()));
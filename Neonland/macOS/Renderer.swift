@@ -7,6 +7,10 @@ class Renderer : NSObject, MTKViewDelegate {
     
     static let maxFramesInFlight = 3
     
+    // Set NEON_COMPACT_INSTANCES to upload 28 byte CompactInstances instead of 80 byte Instances,
+    // decoded by the vertex shaders
+    static let compactInstances = ProcessInfo.processInfo.environment["NEON_COMPACT_INSTANCES"] != nil
+    
     let device: MTLDevice
     let commandQueue: MTLCommandQueue
     
@@ -51,7 +55,8 @@ class Renderer : NSObject, MTKViewDelegate {
             globalUniformsBuffer.label = "Global Uniforms \(i)"
             globalUniformBuffers.append(globalUniformsBuffer)
             
-            let instanceBuffer = device.makeBuffer(length: MemoryLayout<Instance>.size * MAX_INSTANCE_COUNT, options: .storageModeShared)!
+            let instanceStride = Renderer.compactInstances ? MemoryLayout<CompactInstance>.stride : MemoryLayout<Instance>.stride
+            let instanceBuffer = device.makeBuffer(length: instanceStride * MAX_INSTANCE_COUNT, options: .storageModeShared)!
             instanceBuffer.label = "Instances \(i)"
             instanceBuffers.append(instanceBuffer)
             
@@ -177,7 +182,7 @@ class Renderer : NSObject, MTKViewDelegate {
         
         let renderPipelineDescriptor = MTLRenderPipelineDescriptor()
         renderPipelineDescriptor.label = "Lit Render Pipeline State"
-        renderPipelineDescriptor.vertexFunction = library.makeFunction(name: "VertexLit")
+        renderPipelineDescriptor.vertexFunction = library.makeFunction(name: Renderer.compactInstances ? "VertexLitCompact" : "VertexLit")
         renderPipelineDescriptor.fragmentFunction = library.makeFunction(name: "FragmentLit")
         renderPipelineDescriptor.colorAttachments[0].pixelFormat = mtkView.colorPixelFormat
         
@@ -198,7 +203,7 @@ class Renderer : NSObject, MTKViewDelegate {
         let mainRenderPipelineState = try! device.makeRenderPipelineState(descriptor: renderPipelineDescriptor)
         
         renderPipelineDescriptor.label = "UI Render Pipeline State"
-        renderPipelineDescriptor.vertexFunction = library.makeFunction(name: "VertexUI")
+        renderPipelineDescriptor.vertexFunction = library.makeFunction(name: Renderer.compactInstances ? "VertexUICompact" : "VertexUI")
         renderPipelineDescriptor.fragmentFunction = library.makeFunction(name: "FragmentUI")
         let uiRenderPipelineState = try! device.makeRenderPipelineState(descriptor: renderPipelineDescriptor)
         
@@ -233,7 +238,21 @@ class Renderer : NSObject, MTKViewDelegate {
         pollMouseInput(view: view)
         
         let aspectRatio = Float(view.drawableSize.width / view.drawableSize.height)
-        var frameData = Neon_Render(aspectRatio)
+        
+        // The instances are written straight into the next instance buffer
+        bufferIndex = (bufferIndex + 1) % Renderer.maxFramesInFlight
+        var frameData = FrameData()
+        
+        if Renderer.compactInstances {
+            let instances = instanceBuffers[bufferIndex].contents()
+                .bindMemory(to: CompactInstance.self, capacity: MAX_INSTANCE_COUNT)
+            Neon_RenderCompactInto(aspectRatio, instances, MAX_INSTANCE_COUNT, &frameData)
+        }
+        else {
+            let instances = instanceBuffers[bufferIndex].contents()
+                .bindMemory(to: Instance.self, capacity: MAX_INSTANCE_COUNT)
+            Neon_RenderInto(aspectRatio, instances, MAX_INSTANCE_COUNT, &frameData)
+        }
         
         for i in 0..<frameData.audioCount {
             let audioIndex = frameData.audios.advanced(by: i).pointee
@@ -337,11 +356,6 @@ class Renderer : NSObject, MTKViewDelegate {
     }
     
     func updateUniforms(frameData: inout FrameData) {
-        bufferIndex = (bufferIndex + 1) % Renderer.maxFramesInFlight
-        
-        instanceBuffers[bufferIndex].contents()
-            .copyMemory(from: frameData.instances, byteCount: MemoryLayout<Instance>.size * frameData.instanceCount)
-        
         globalUniformBuffers[bufferIndex].contents()
             .copyMemory(from: &frameData.globalUniforms, byteCount: MemoryLayout<GlobalUniforms>.size)
         
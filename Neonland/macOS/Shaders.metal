@@ -22,12 +22,31 @@ struct FragmentDataUI {
     float4 tint;
 };
 
-vertex auto VertexLit(Vertex in [[stage_in]],
-                       uint instanceId [[instance_id]],
-                       constant Instance* instances [[buffer(1)]],
-                       constant GlobalUniforms& sceneData [[buffer(2)]]) -> FragmentDataLit {
-    Instance instance = instances[instanceId];
+// Expands a CompactInstance to the model matrix T * Rz * Ry * Rx * S and color, as
+// DecodeCompactInstances in Engine/CompactInstance.hpp does
+auto DecodeCompactInstance(constant CompactInstance& compact) -> Instance {
+    float3 angles = float3(compact.rotation[0], compact.rotation[1], compact.rotation[2]) * (2 * M_PI_F / 65536);
+    float3 cosines;
+    float3 sines = sincos(angles, cosines);
     
+    float3x3 rotationX = float3x3(float3(1, 0, 0), float3(0, cosines.x, sines.x), float3(0, -sines.x, cosines.x));
+    float3x3 rotationY = float3x3(float3(cosines.y, 0, -sines.y), float3(0, 1, 0), float3(sines.y, 0, cosines.y));
+    float3x3 rotationZ = float3x3(float3(cosines.z, sines.z, 0), float3(-sines.z, cosines.z, 0), float3(0, 0, 1));
+    float3x3 rotation = rotationZ * rotationY * rotationX;
+    
+    float3 scale = float3(as_type<half>(compact.scale[0]), as_type<half>(compact.scale[1]), as_type<half>(compact.scale[2]));
+    
+    Instance instance;
+    instance.transform = float4x4(float4(rotation[0] * scale.x, 0),
+                                  float4(rotation[1] * scale.y, 0),
+                                  float4(rotation[2] * scale.z, 0),
+                                  float4(compact.position[0], compact.position[1], compact.position[2], 1));
+    instance.color = unpack_unorm4x8_to_float(compact.color);
+    
+    return instance;
+}
+
+auto ShadeVertexLit(Vertex in, Instance instance, constant GlobalUniforms& sceneData) -> FragmentDataLit {
     float4 viewPos = sceneData.viewMatrix * instance.transform * float4(in.position, 1);
     float4 viewNormal = sceneData.viewMatrix * instance.transform * float4(in.normal, 0);
     
@@ -42,6 +61,20 @@ vertex auto VertexLit(Vertex in [[stage_in]],
     return out;
 }
 
+vertex auto VertexLit(Vertex in [[stage_in]],
+                       uint instanceId [[instance_id]],
+                       constant Instance* instances [[buffer(1)]],
+                       constant GlobalUniforms& sceneData [[buffer(2)]]) -> FragmentDataLit {
+    return ShadeVertexLit(in, instances[instanceId], sceneData);
+}
+
+vertex auto VertexLitCompact(Vertex in [[stage_in]],
+                              uint instanceId [[instance_id]],
+                              constant CompactInstance* instances [[buffer(1)]],
+                              constant GlobalUniforms& sceneData [[buffer(2)]]) -> FragmentDataLit {
+    return ShadeVertexLit(in, DecodeCompactInstance(instances[instanceId]), sceneData);
+}
+
 fragment auto FragmentLit(FragmentDataLit in [[stage_in]],
                            texture2d<float, access::sample> texMap [[texture(0)]],
                            sampler texSampler [[sampler(0)]],
@@ -63,12 +96,7 @@ fragment auto FragmentLit(FragmentDataLit in [[stage_in]],
     return float4((litColor * baseColor.a), baseColor.a);
 }
 
-vertex auto VertexUI(Vertex in [[stage_in]],
-                     uint instanceId [[instance_id]],
-                     constant Instance* instances [[buffer(1)]],
-                     constant GlobalUniforms& sceneData [[buffer(2)]]) -> FragmentDataUI {
-    Instance instance = instances[instanceId];
-    
+auto ShadeVertexUI(Vertex in, Instance instance, constant GlobalUniforms& sceneData) -> FragmentDataUI {
     FragmentDataUI out;
     out.position = sceneData.projMatrix * sceneData.viewMatrix * instance.transform * float4(in.position, 1);
     out.position.z = 0.1f;
@@ -78,6 +106,20 @@ vertex auto VertexUI(Vertex in [[stage_in]],
     return out;
 }
 
+vertex auto VertexUI(Vertex in [[stage_in]],
+                     uint instanceId [[instance_id]],
+                     constant Instance* instances [[buffer(1)]],
+                     constant GlobalUniforms& sceneData [[buffer(2)]]) -> FragmentDataUI {
+    return ShadeVertexUI(in, instances[instanceId], sceneData);
+}
+
+vertex auto VertexUICompact(Vertex in [[stage_in]],
+                            uint instanceId [[instance_id]],
+                            constant CompactInstance* instances [[buffer(1)]],
+                            constant GlobalUniforms& sceneData [[buffer(2)]]) -> FragmentDataUI {
+    return ShadeVertexUI(in, DecodeCompactInstance(instances[instanceId]), sceneData);
+}
+
 fragment auto FragmentUI(FragmentDataUI in [[stage_in]],
                           texture2d<float, access::sample> texMap [[texture(0)]],
                           sampler texSampler [[sampler(0)]],